@@ -22,8 +22,19 @@
 ::std::vector<::std::string>    AST::g_crate_load_dirs = { };
 ::std::map<::std::string, ::std::string>    AST::g_crate_overrides;
 ::std::map<RcString, RcString>    AST::g_implicit_crates;
+bool    AST::g_allow_metadata_only_crates = false;
 
 namespace {
+    /// Check that a crate file given by path exists
+    /// - The metadata is written before the code, so a crate still being built by a pipelined build (e.g. minicargo)
+    ///   only has the `.hir` so far. That's all that's needed to compile against it, but only accept that when the
+    ///   build tool is pipelining (otherwise it's a leftover from a failed or interrupted build).
+    bool crate_file_exists(const ::std::string& path)
+    {
+        if( ::std::ifstream(path).good() )
+            return true;
+        return AST::g_allow_metadata_only_crates && ::std::ifstream(path + ".hir").good();
+    }
     bool check_item_cfg(const ::AST::AttributeList& attrs)
     {
         for(const auto& at : attrs.m_items) {
@@ -152,7 +163,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
     if(basename == "" && it != g_crate_overrides.end())
     {
         path = it->second;
-        if( !::std::ifstream(path).good() ) {
+        if( !crate_file_exists(path) ) {
             ERROR(sp, E0000, "Unable to open crate '" << name << "' at path " << path);
         }
         DEBUG("path = " << path << " (--extern)");
@@ -172,7 +183,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
             }
         }
 #endif
-        if( !::std::ifstream(path).good() ) {
+        if( !crate_file_exists(path) ) {
             ERROR(sp, E0000, "Unable to locate crate '" << name << "' with filename " << basename << " in search directories");
         }
         DEBUG("path = " << path << " (basename)");
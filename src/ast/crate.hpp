@@ -119,5 +119,7 @@ public:
 extern ::std::vector<::std::string>    g_crate_load_dirs;
 extern ::std::map<::std::string, ::std::string>    g_crate_overrides;
 extern ::std::map<RcString, RcString>    g_implicit_crates;
+// Accept extern crates that only have metadata (`.hir`) so far, set when the build tool is pipelining builds
+extern bool g_allow_metadata_only_crates;
 
 }   // namespace AST
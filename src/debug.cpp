@@ -14,68 +14,55 @@
 #include <cstring>	// strchr
 
 
-int g_debug_indent_level = 0;
+thread_local int g_debug_indent_level = 0;
+#ifndef DISABLE_DEBUG
 bool g_debug_enabled = true;
+#else
+bool g_debug_enabled = false;
+#endif
 ::std::string g_cur_phase;
 ::std::set< ::std::string>    g_debug_disable_map;
 
-TraceLog::TraceLog(const char* tag, ::std::function<void(::std::ostream&)> info_cb, ::std::function<void(::std::ostream&)> ret):
-    m_tag(tag),
-    m_ret(ret)
+void TraceLog::enter()
 {
-    if(debug_enabled() && m_tag) {
-        auto& os = debug_output(g_debug_indent_level, m_tag);
-        os << ">> (";
-        info_cb(os);
-        os << ")" << ::std::endl;
-    }
+    debug_output(g_debug_indent_level, m_tag) << ">>" << ::std::endl;
     INDENT();
 }
-TraceLog::TraceLog(const char* tag, ::std::function<void(::std::ostream&)> info_cb):
-    m_tag(tag),
-    m_ret([](const auto&){})
+::std::ostream& TraceLog::enter_start()
 {
-    if(debug_enabled() && m_tag) {
-        auto& os = debug_output(g_debug_indent_level, m_tag);
-        os << ">> (";
-        info_cb(os);
-        os << ")" << ::std::endl;
-    }
-    INDENT();
+    auto& os = debug_output(g_debug_indent_level, m_tag);
+    os << ">> (";
+    return os;
 }
-TraceLog::TraceLog(const char* tag):
-    m_tag(tag),
-    m_ret([](const auto&){})
+void TraceLog::enter_end(::std::ostream& os)
 {
-    if(debug_enabled() && m_tag) {
-        auto& os = debug_output(g_debug_indent_level, m_tag);
-        os << ">>" << ::std::endl;
-    }
+    os << ")" << ::std::endl;
     INDENT();
 }
-TraceLog::~TraceLog() {
+void TraceLog::exit()
+{
     UNINDENT();
-    if(debug_enabled() && m_tag) {
-        auto& os = debug_output(g_debug_indent_level, m_tag);
-        os << "<< (";
-        m_ret(os);
-        os << ")" << ::std::endl;
-    }
+    auto& os = debug_output(g_debug_indent_level, m_tag);
+    os << "<< (";
+    if(m_ret_fcn)
+        m_ret_fcn(m_ret, os);
+    os << ")" << ::std::endl;
 }
 
 
 
 bool debug_enabled_update() {
+#ifdef DISABLE_DEBUG
+    // Tracing is compiled out, keep the explicit `debug_enabled()` checks consistent with that
+    return false;
+#else
     if( g_debug_disable_map.count(g_cur_phase) != 0 ) {
         return false;
     }
     else {
         return true;
     }
-}
-bool debug_enabled()
-{
-    return g_debug_enabled;
+#endif
 }
 ::std::ostream& debug_output(int indent, const char* function)
 {
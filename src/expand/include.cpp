@@ -13,6 +13,7 @@
 #include <parse/lex.hpp>    // Lexer (new files)
 #include <ast/expr.hpp>
 #include <ast/crate.hpp>
+#include <fstream>
 
 namespace {
 
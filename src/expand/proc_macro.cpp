@@ -14,6 +14,7 @@
 #include <hir/hir.hpp>  // ABI_RUST
 #include "proc_macro.hpp"
 #include <parse/lex.hpp>
+#include <fstream>
 #ifdef _WIN32
 # define NOMINMAX
 # define NOGDI  // Don't include GDI functions (defines some macros that collide with mrustc ones)
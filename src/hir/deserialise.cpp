@@ -22,13 +22,29 @@
     {
     };
 
+    /// MIR bodies for a loaded crate, decoded when first used
+    class MirBlobTable:
+        public ::MIR::FunctionPointer::LazySource
+    {
+    public:
+        RcString    m_crate_name;
+        ::std::shared_ptr<const ::std::vector<RcString>>    m_strings;
+        ::std::shared_ptr<const uint8_t>    m_data;
+        // Start of each body in `m_data` (with an extra entry for the end)
+        ::std::vector<size_t>   m_offsets;
+
+        ::MIR::Function* load(size_t idx) const override;
+    };
+
     class HirDeserialiser
     {
         RcString m_crate_name;
         ::std::vector<HIR::TypeRef> m_types;
         ::HIR::serialise::Reader&   m_in;
+        ::std::shared_ptr<MirBlobTable> m_mir_blobs;
     public:
-        HirDeserialiser(::HIR::serialise::Reader& in):
+        HirDeserialiser(::HIR::serialise::Reader& in, RcString crate_name=RcString()):
+            m_crate_name(crate_name),
             m_in(in)
         {}
 
@@ -493,12 +509,13 @@
             auto _ = m_in.open_object("HIR::ExprPtr");
             if( m_in.read_bool() )
             {
-                rv.m_mir = deserialise_mir();
+                rv.m_mir = ::MIR::FunctionPointer::lazy(m_mir_blobs, m_in.read_u64c());
             }
             rv.m_erased_types = deserialise_vec< ::HIR::TypeRef>();
             return rv;
         }
-        ::MIR::FunctionPointer deserialise_mir();
+        ::MIR::Function deserialise_mir();
+        void deserialise_mir_blobs();
         ::MIR::BasicBlock deserialise_mir_basicblock();
         ::MIR::Statement deserialise_mir_statement();
         ::MIR::Terminator deserialise_mir_terminator();
@@ -944,7 +961,8 @@
     DEF_D( ::HIR::Crate::ImplGroup<T>,
         ::HIR::Crate::ImplGroup<T>  rv;
         rv.named = d.deserialise_pathmap< ::std::vector<::std::unique_ptr<T> > >();
-        rv.non_named = d.deserialise_vec< ::std::unique_ptr<T> >();
+        for(auto& impl : d.deserialise_vec< ::std::unique_ptr<T> >())
+            rv.get_list_for_type_mut(impl->m_type).push_back(mv$(impl));
         rv.generic = d.deserialise_vec< ::std::unique_ptr<T> >();
         return rv;
         )
@@ -1319,7 +1337,7 @@
         }
     }
 
-    ::MIR::FunctionPointer HirDeserialiser::deserialise_mir()
+    ::MIR::Function HirDeserialiser::deserialise_mir()
     {
         TRACE_FUNCTION;
 
@@ -1330,7 +1348,30 @@
         rv.drop_flags = deserialise_vec<bool>();
         rv.blocks = deserialise_vec< ::MIR::BasicBlock>( );
 
-        return ::MIR::FunctionPointer( new ::MIR::Function(mv$(rv)) );
+        return rv;
+    }
+    void HirDeserialiser::deserialise_mir_blobs()
+    {
+        auto& t = *m_mir_blobs;
+        m_in.enter_section(::HIR::serialise::Section::Mir);
+        size_t n = m_in.read_u64c();
+        t.m_offsets.reserve(n + 1);
+        for(size_t i = 0; i < n + 1; i ++)
+        {
+            t.m_offsets.push_back( m_in.read_u64c() );
+        }
+        // NOTE: If the file is memory-mapped, this references the mapping instead of copying
+        t.m_data = m_in.read_shared( t.m_offsets.back() );
+        DEBUG(n << " MIR bodies, " << t.m_offsets.back() << " bytes");
+    }
+    ::MIR::Function* MirBlobTable::load(size_t idx) const
+    {
+        TRACE_FUNCTION_F(m_crate_name << " #" << idx);
+        ASSERT_BUG(Span(), idx + 1 < m_offsets.size(), "MIR index " << idx << " out of range for " << m_crate_name);
+        auto ofs = m_offsets[idx];
+        ::HIR::serialise::Reader    in { m_data.get() + ofs, m_offsets[idx+1] - ofs, m_strings };
+        HirDeserialiser s { in, m_crate_name };
+        return new ::MIR::Function( s.deserialise_mir() );
     }
     ::MIR::BasicBlock HirDeserialiser::deserialise_mir_basicblock()
     {
@@ -1490,19 +1531,26 @@
     {
         ::HIR::Crate    rv;
 
+        m_in.enter_section(::HIR::serialise::Section::Items);
         this->m_crate_name = m_in.read_istring();
         assert(this->m_crate_name != "" && "Empty crate name loaded from metadata");
         rv.m_crate_name = this->m_crate_name;
+        m_mir_blobs = ::std::make_shared<MirBlobTable>();
+        m_mir_blobs->m_crate_name = this->m_crate_name;
+        m_mir_blobs->m_strings = m_in.get_strings();
         rv.m_edition = static_cast<AST::Edition>(m_in.read_tag());
         rv.m_root_module = deserialise_module();
 
+        m_in.enter_section(::HIR::serialise::Section::Impls);
         rv.m_type_impls = D< ::HIR::Crate::ImplGroup<::HIR::TypeImpl> >::des(*this);
         rv.m_trait_impls = deserialise_pathmap< ::HIR::Crate::ImplGroup<::HIR::TraitImpl>>();
         rv.m_marker_impls = deserialise_pathmap< ::HIR::Crate::ImplGroup<::HIR::MarkerImpl>>();
 
+        m_in.enter_section(::HIR::serialise::Section::Macros);
         rv.m_exported_macro_names = deserialise_vec< ::RcString>();
         //rv.m_exported_macros = deserialise_istrumap< ::MacroRulesPtr>();
         //rv.m_proc_macro_reexports = deserialise_istrumap< ::HIR::Crate::MacroImport>();
+        m_in.enter_section(::HIR::serialise::Section::Info);
         rv.m_lang_items = deserialise_strumap< ::HIR::SimplePath>();
 
         {
@@ -1521,6 +1569,8 @@
         rv.m_ext_libs = deserialise_vec< ::HIR::ExternLibrary>();
         rv.m_link_paths = deserialise_vec< ::std::string>();
 
+        deserialise_mir_blobs();
+
         //rv.m_proc_macros = deserialise_vec< ::HIR::ProcMacro>();
 
         return rv;
@@ -17,6 +17,7 @@
 #include <hir/item_path.hpp>
 #include <limits.h>
 #include <hir_typeck/helpers.hpp>   // monomorph
+#include <time_report.hpp>
 
 ::HIR::Module LowerHIR_Module(const ::AST::Module& module, ::HIR::ItemPath path, ::std::vector< ::HIR::SimplePath> traits = {});
 ::HIR::Function LowerHIR_Function(::HIR::ItemPath path, const ::AST::AttributeList& attrs, const ::AST::Function& f, const ::HIR::TypeRef& self_type);
@@ -1740,6 +1741,9 @@ void _add_mod_mac_item(::HIR::Module& mod, RcString name, ::HIR::Publicity is_pu
         }
     }
 
+    // `items` counts every entry in every module's item list (including `use`, `impl` and macro items), but not the
+    // items within impl blocks (counted as `impl_items` in `LowerHIR_Module_Impls`)
+    TimeReport_AddCount("items", ast_mod.m_items.size());
     for( const auto& ip : ast_mod.m_items )
     {
         const auto& item = *ip;
@@ -1935,6 +1939,7 @@ void LowerHIR_Module_Impls(const ::AST::Module& ast_mod,  ::HIR::Crate& hir_crat
         if( !i->data.is_Impl() ) continue;
         const auto& impl = i->data.as_Impl();
         const Span  impl_span;
+        TimeReport_AddCount("impl_items", impl.items().size());
         auto params = LowerHIR_GenericParams(impl.def().params(), nullptr);
 
         TRACE_FUNCTION_F("IMPL " << impl.def());
@@ -571,11 +571,39 @@ public:
     {
         typedef ::std::vector<::std::unique_ptr<T>> list_t;
         ::std::map<::HIR::SimplePath, list_t>   named;
-        list_t  non_named; // TODO: use a map of HIR::TypeRef::Data::Tag
+        /// Impls on non-path types, keyed by `get_non_named_key` (type tag, and the core type for primitives)
+        ::std::map<unsigned, list_t>  non_named;
         list_t  generic;
 
+        static unsigned get_non_named_key(::HIR::TypeData::Tag tag, unsigned sub=0) {
+            return static_cast<unsigned>(tag) << 8 | sub;
+        }
+        static unsigned get_non_named_key(const ::HIR::CoreType& ct) {
+            return get_non_named_key(::HIR::TypeData::TAG_Primitive, static_cast<unsigned>(ct));
+        }
+        /// Get the `non_named` key for a type, returns false if the type could match impls in any `non_named` list
+        static bool get_non_named_key(const ::HIR::TypeRef& ty, unsigned& out_key) {
+            switch(ty.data().tag())
+            {
+            case ::HIR::TypeData::TAG_Primitive:
+                out_key = get_non_named_key(ty.data().as_Primitive());
+                return true;
+            case ::HIR::TypeData::TAG_Diverge:
+            case ::HIR::TypeData::TAG_Array:
+            case ::HIR::TypeData::TAG_Slice:
+            case ::HIR::TypeData::TAG_Tuple:
+            case ::HIR::TypeData::TAG_Borrow:
+            case ::HIR::TypeData::TAG_Pointer:
+            case ::HIR::TypeData::TAG_Function:
+                out_key = get_non_named_key(ty.data().tag());
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /// Get the list for an exact type (nullptr if there are no impls)
         const list_t* get_list_for_type(const ::HIR::TypeRef& ty) const {
-            static list_t empty;
             if( const auto* p = ty.get_sort_path() ) {
                 auto it = named.find(*p);
                 if( it != named.end() )
@@ -584,8 +612,14 @@ public:
                     return nullptr;
             }
             else {
-                // TODO: Sort these by type tag, use the `Primitive` group if `ty` is Infer
-                return &non_named;
+                unsigned key;
+                if( !get_non_named_key(ty, key) )
+                    return nullptr;
+                auto it = non_named.find(key);
+                if( it != non_named.end() )
+                    return &it->second;
+                else
+                    return nullptr;
             }
         }
         list_t& get_list_for_type_mut(const ::HIR::TypeRef& ty) {
@@ -593,9 +627,43 @@ public:
                 return named[*p];
             }
             else {
-                // TODO: Ivars match with core types
-                return non_named;
+                unsigned key;
+                if( !get_non_named_key(ty, key) )
+                    key = get_non_named_key(ty.data().tag());
+                return non_named[key];
+            }
+        }
+        /// Call `cb` with each (non-generic) list that could contain an impl for `ty`, stops if `cb` returns true
+        /// - Ivars use the primitive lists matching their class, other un-sortable types search all `non_named` lists
+        template<typename Cb>
+        bool find_lists_for_type(const ::HIR::TypeRef& ty, Cb cb) const {
+            if( ty.get_sort_path() ) {
+                const auto* l = get_list_for_type(ty);
+                return l && cb(*l);
+            }
+            unsigned key;
+            if( get_non_named_key(ty, key) ) {
+                auto it = non_named.find(key);
+                return it != non_named.end() && cb(it->second);
+            }
+            if( const auto* e = ty.data().opt_Infer() ) {
+                if( e->ty_class == ::HIR::InferClass::Integer || e->ty_class == ::HIR::InferClass::Float ) {
+                    for(auto& l : non_named) {
+                        if( (l.first >> 8) != ::HIR::TypeData::TAG_Primitive )
+                            continue;
+                        auto ct = static_cast<::HIR::CoreType>(l.first & 0xFF);
+                        bool is_match = (e->ty_class == ::HIR::InferClass::Integer ? is_integer(ct) : is_float(ct));
+                        if( is_match && cb(l.second) )
+                            return true;
+                    }
+                    return false;
+                }
+            }
+            for(auto& l : non_named) {
+                if( cb(l.second) )
+                    return true;
             }
+            return false;
         }
     };
     /// Impl blocks on just a type, split into three groups
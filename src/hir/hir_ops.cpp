@@ -984,11 +984,8 @@ namespace
         if( it != crate.m_trait_impls.end() )
         {
             // 1. Find named impls (associated with named types)
-            if( const auto* impl_list = it->second.get_list_for_type(type) )
-            {
-                if( find_impls_list(*impl_list, type, ty_res, callback) )
-                    return true;
-            }
+            if( it->second.find_lists_for_type(type, [&](const auto& impl_list){ return find_impls_list(impl_list, type, ty_res, callback); }) )
+                return true;
             // - If the type is an ivar, search all types
             if( type.data().is_Infer() && !type.data().as_Infer().is_lit() )
             {
@@ -1035,11 +1032,8 @@ namespace
         if( it != crate.m_marker_impls.end() )
         {
             // 1. Find named impls (associated with named types)
-            if( const auto* impl_list = it->second.get_list_for_type(type) )
-            {
-                if( find_impls_list(*impl_list, type, ty_res, callback) )
-                    return true;
-            }
+            if( it->second.find_lists_for_type(type, [&](const auto& impl_list){ return find_impls_list(impl_list, type, ty_res, callback); }) )
+                return true;
 
             // 2. Search fully generic list.
             if( find_impls_list(it->second.generic, type, ty_res, callback) )
@@ -1069,11 +1063,8 @@ namespace
     bool find_type_impls_int(const ::HIR::Crate& crate, const ::HIR::TypeRef& type, ::HIR::t_cb_resolve_type ty_res, ::std::function<bool(const ::HIR::TypeImpl&)> callback)
     {
         // 1. Find named impls (associated with named types)
-        if( const auto* impl_list = crate.m_type_impls.get_list_for_type(type) )
-        {
-            if( find_impls_list(*impl_list, type, ty_res, callback) )
-                return true;
-        }
+        if( crate.m_type_impls.find_lists_for_type(type, [&](const auto& impl_list){ return find_impls_list(impl_list, type, ty_res, callback); }) )
+            return true;
 
         // 2. Search fully generic list?
         if( find_impls_list(crate.m_type_impls.generic, type, ty_res, callback) )
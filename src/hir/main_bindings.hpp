@@ -17,5 +17,6 @@ namespace AST {
 
 extern void HIR_Dump(::std::ostream& sink, const ::HIR::Crate& crate);
 extern ::HIR::CratePtr  LowerHIR_FromAST(::AST::Crate crate);
-extern void HIR_Serialise(const ::std::string& filename, const ::HIR::Crate& crate);
+/// Save crate metadata, if `compress` is false the uncompressed memory-mappable format is used
+extern void HIR_Serialise(const ::std::string& filename, const ::HIR::Crate& crate, bool compress=true);
 extern ::HIR::CratePtr HIR_Deserialise(const ::std::string& filename);
@@ -267,11 +267,22 @@ public:
     bool operator==(const Path& x) const;
     bool operator!=(const Path& x) const { return !(*this == x); }
     bool operator<(const Path& x) const { return ord(x) == OrdLess; }
+    /// Structural hash (consistent with `==`)
+    size_t hash() const;
 
     friend ::std::ostream& operator<<(::std::ostream& os, const Path& x);
 };
 
 }   // namespace HIR
 
+namespace std {
+    template<> struct hash<::HIR::Path>
+    {
+        size_t operator()(const ::HIR::Path& p) const noexcept {
+            return p.hash();
+        }
+    };
+}
+
 #endif
 
@@ -16,6 +16,8 @@
     {
         ::std::map<HIR::TypeRef, size_t>    m_types;
         ::HIR::serialise::Writer&   m_out;
+        // Encoded MIR bodies, written at the end of the crate
+        ::std::vector< ::std::vector<uint8_t> > m_mir_blobs;
     public:
         HirSerialiser(::HIR::serialise::Writer& out):
             m_out( out )
@@ -23,6 +25,7 @@
 
         void clear() {
             m_types.clear();
+            m_mir_blobs.clear();
         }
 
         template<typename V>
@@ -366,22 +369,37 @@
         void serialise(const ::HIR::Crate::ImplGroup<T>& ig)
         {
             serialise_pathmap(ig.named);
-            serialise_vec(ig.non_named);
+            // `non_named` is stored flat, and re-grouped on load
+            {
+                typedef typename ::HIR::Crate::ImplGroup<T>::list_t  list_t;
+                size_t  count = 0;
+                for(const auto& l : ig.non_named)
+                    count += l.second.size();
+                auto _ = m_out.open_object(typeid(list_t).name());
+                m_out.write_count(count);
+                for(const auto& l : ig.non_named)
+                    for(const auto& i : l.second)
+                        serialise(i);
+            }
             serialise_vec(ig.generic);
         }
 
         void serialise_crate(const ::HIR::Crate& crate)
         {
+            m_out.start_section(::HIR::serialise::Section::Items);
             m_out.write_string(crate.m_crate_name);
             m_out.write_tag(static_cast<int>(crate.m_edition));
             serialise_module(crate.m_root_module);
 
+            m_out.start_section(::HIR::serialise::Section::Impls);
             serialise(crate.m_type_impls);
             serialise_pathmap(crate.m_trait_impls);
             serialise_pathmap(crate.m_marker_impls);
 
+            m_out.start_section(::HIR::serialise::Section::Macros);
             serialise_vec(crate.m_exported_macro_names);
 
+            m_out.start_section(::HIR::serialise::Section::Info);
             {
                 decltype(crate.m_lang_items)    lang_items_filtered;
                 for(const auto& ent : crate.m_lang_items)
@@ -403,6 +421,25 @@
             }
             serialise_vec(crate.m_ext_libs);
             serialise_vec(crate.m_link_paths);
+
+            serialise_mir_blobs();
+        }
+        // MIR bodies are stored after everything else with an offset table, so they can be decoded on demand
+        void serialise_mir_blobs()
+        {
+            m_out.start_section(::HIR::serialise::Section::Mir);
+            m_out.write_u64c(m_mir_blobs.size());
+            size_t ofs = 0;
+            for(const auto& b : m_mir_blobs)
+            {
+                m_out.write_u64c(ofs);
+                ofs += b.size();
+            }
+            m_out.write_u64c(ofs);
+            for(const auto& b : m_mir_blobs)
+            {
+                m_out.write(b.data(), b.size());
+            }
         }
         void serialise(const ::HIR::ExternLibrary& lib)
         {
@@ -677,7 +714,16 @@
             save_mir &= static_cast<bool>(exp.m_mir);
             m_out.write_bool( save_mir );
             if( save_mir ) {
+                m_out.write_u64c(m_mir_blobs.size());
+                // Each body is self-contained (no references to types cached in the main stream)
+                ::std::vector<uint8_t>  blob;
+                auto saved_types = ::std::move(m_types);
+                m_types.clear();
+                m_out.start_blob(blob);
                 serialise(*exp.m_mir);
+                m_out.end_blob();
+                m_types = ::std::move(saved_types);
+                m_mir_blobs.push_back(::std::move(blob));
             }
             serialise_vec( exp.m_erased_types );
         }
@@ -1236,13 +1282,13 @@
     };
 //}
 
-void HIR_Serialise(const ::std::string& filename, const ::HIR::Crate& crate)
+void HIR_Serialise(const ::std::string& filename, const ::HIR::Crate& crate, bool compress)
 {
     ::HIR::serialise::Writer    out;
     HirSerialiser  s { out };
     s.serialise_crate(crate);
     s.clear();
-    out.open(filename);
+    out.open(filename, compress);
     s.serialise_crate(crate);
 }
 
@@ -9,36 +9,123 @@
 #include "serialise_lowlevel.hpp"
 #include <zlib.h>
 #include <fstream>
+#include <cstdio>   // rename
 #include <string.h>   // memcpy
 #include <common.hpp>
 #include <algorithm>
+#ifdef _WIN32
+# define NOMINMAX
+# define NOGDI  // Don't include GDI functions (defines some macros that collide with mrustc ones)
+# include <Windows.h>
+#else
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 
 namespace HIR {
 namespace serialise {
 
+namespace {
+    // Magic for the uncompressed format (the final byte is the format version)
+    // - zlib streams start with 0x78, so this can't be confused with a compressed file
+    const uint8_t RAW_MAGIC[8] = { 0x7F, 'M', 'R', 'H', 'I', 'R', 0, 1 };
+    // Magic, then u32 section count and u32 reserved
+    const size_t RAW_HEADER_SIZE = 16;
+    // u32 id, u32 reserved, u64 offset, u64 size
+    const size_t RAW_SECTION_ENTRY_SIZE = 24;
+
+    void put_u32(uint8_t* p, uint32_t v) {
+        for(int i = 0; i < 4; i ++)
+            p[i] = static_cast<uint8_t>(v >> (8*i));
+    }
+    void put_u64(uint8_t* p, uint64_t v) {
+        for(int i = 0; i < 8; i ++)
+            p[i] = static_cast<uint8_t>(v >> (8*i));
+    }
+    uint32_t get_u32(const uint8_t* p) {
+        uint32_t rv = 0;
+        for(int i = 0; i < 4; i ++)
+            rv |= static_cast<uint32_t>(p[i]) << (8*i);
+        return rv;
+    }
+    uint64_t get_u64(const uint8_t* p) {
+        uint64_t rv = 0;
+        for(int i = 0; i < 8; i ++)
+            rv |= static_cast<uint64_t>(p[i]) << (8*i);
+        return rv;
+    }
+}
+
+const char* section_name(Section s)
+{
+    switch(s)
+    {
+    case Section::Strings:  return "strings";
+    case Section::Items:    return "items";
+    case Section::Impls:    return "impls";
+    case Section::Macros:   return "macros";
+    case Section::Info: return "info";
+    case Section::Mir:  return "mir";
+    }
+    return "?";
+}
+
 class WriterInner
 {
+    // Written to a temporary file then renamed over the output, as other processes may have the old file mapped (or
+    // be reading it, e.g. a pipelined build of a dependent crate)
+    ::std::string   m_filename;
+    ::std::string   m_tmp_filename;
     ::std::ofstream m_backing;
+    bool    m_compress;
     z_stream    m_zstream;
     ::std::vector<unsigned char> m_buffer;
 
+    // Uncompressed output, written out with the section directory when complete
+    ::std::vector<unsigned char> m_raw;
+    ::std::vector<SectionEntry> m_sections;
+
     unsigned int    m_byte_out_count = 0;
     unsigned int    m_byte_in_count = 0;
 public:
-    WriterInner(const ::std::string& filename);
+    WriterInner(const ::std::string& filename, bool compress);
     ~WriterInner();
     void write(const void* buf, size_t len);
+    void start_section(Section s);
+private:
+    void write_raw_file();
+    void commit_file();
+};
+
+class MappedFile
+{
+    const uint8_t*  m_data;
+    size_t  m_size;
+#ifdef _WIN32
+    HANDLE  m_file;
+    HANDLE  m_map;
+#endif
+public:
+    MappedFile(const ::std::string& filename);
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
 };
 
 Writer::Writer():
-    m_inner(nullptr)
+    m_inner(nullptr),
+    m_blob(nullptr)
 {
 }
 Writer::~Writer()
 {
     delete m_inner, m_inner = nullptr;
 }
-void Writer::open(const ::std::string& filename)
+void Writer::open(const ::std::string& filename, bool compress)
 {
     // 1. Sort strings by frequency
     ::std::vector<::std::pair<RcString, unsigned>> sorted;
@@ -50,8 +137,9 @@ void Writer::open(const ::std::string& filename)
 
     m_objname_cache.clear();
 
-    m_inner = new WriterInner(filename);
+    m_inner = new WriterInner(filename, compress);
     // 3. Reset m_istring_cache to use the same value
+    this->start_section(Section::Strings);
     this->write_count(sorted.size());
     for(size_t i = 0; i < sorted.size(); i ++)
     {
@@ -67,13 +155,38 @@ void Writer::open(const ::std::string& filename)
 }
 void Writer::write(const void* buf, size_t len)
 {
-    if( m_inner ) {
-        m_inner->write(buf, len);
+    if( !m_inner ) {
+        // No-op, pre caching
+    }
+    else if( m_blob ) {
+        const auto* p = static_cast<const uint8_t*>(buf);
+        m_blob->insert(m_blob->end(), p, p + len);
     }
     else {
-        // No-op, pre caching
+        m_inner->write(buf, len);
+    }
+}
+void Writer::start_section(Section s)
+{
+    if( m_inner ) {
+        assert(!m_blob);
+        m_inner->start_section(s);
     }
 }
+void Writer::start_blob(::std::vector<uint8_t>& out)
+{
+    assert(!m_blob);
+    m_blob = &out;
+    m_saved_objname_cache = ::std::move(m_objname_cache);
+    m_objname_cache.clear();
+}
+void Writer::end_blob()
+{
+    assert(m_blob);
+    m_blob = nullptr;
+    m_objname_cache = ::std::move(m_saved_objname_cache);
+    m_saved_objname_cache.clear();
+}
 void Writer::write_string(const RcString& v)
 {
     if( m_inner ) {
@@ -87,12 +200,17 @@ void Writer::write_string(const RcString& v)
 }
 
 
-WriterInner::WriterInner(const ::std::string& filename):
-    m_backing( filename, ::std::ios_base::out | ::std::ios_base::binary),
+WriterInner::WriterInner(const ::std::string& filename, bool compress):
+    m_filename(filename),
+    m_tmp_filename(filename + ".tmp"),
+    m_backing( m_tmp_filename, ::std::ios_base::out | ::std::ios_base::binary),
+    m_compress(compress),
     m_zstream(),
     m_buffer( 16*1024 )
     //m_buffer( 4*1024 )
 {
+    if( !m_compress )
+        return ;
     m_zstream.zalloc = Z_NULL;
     m_zstream.zfree = Z_NULL;
     m_zstream.opaque = Z_NULL;
@@ -107,6 +225,12 @@ WriterInner::WriterInner(const ::std::string& filename):
 }
 WriterInner::~WriterInner()
 {
+    if( !m_compress )
+    {
+        write_raw_file();
+        commit_file();
+        return ;
+    }
     assert( m_zstream.avail_in == 0 );
 
     // Complete the compression
@@ -129,10 +253,67 @@ WriterInner::~WriterInner()
         }
     } while(ret == Z_OK);
     deflateEnd(&m_zstream);
+    commit_file();
+}
+void WriterInner::commit_file()
+{
+    m_backing.close();
+    if( m_backing.fail() ) {
+        ::std::cerr << "ERROR: Failed to write " << m_tmp_filename << ::std::endl;
+        abort();
+    }
+#ifdef _WIN32
+    bool ok = MoveFileExA(m_tmp_filename.c_str(), m_filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    // NOTE: Replaces the directory entry, anything that has the old file open/mapped keeps the old contents
+    bool ok = ::std::rename(m_tmp_filename.c_str(), m_filename.c_str()) == 0;
+#endif
+    if( !ok ) {
+        ::std::cerr << "ERROR: Unable to rename " << m_tmp_filename << " to " << m_filename << ::std::endl;
+        abort();
+    }
+}
+
+void WriterInner::start_section(Section s)
+{
+    if( !m_compress )
+    {
+        m_sections.push_back(SectionEntry { s, m_raw.size(), 0 });
+    }
+}
+void WriterInner::write_raw_file()
+{
+    uint64_t data_ofs = RAW_HEADER_SIZE + RAW_SECTION_ENTRY_SIZE * m_sections.size();
+    for(size_t i = 0; i < m_sections.size(); i ++)
+    {
+        auto end = (i + 1 < m_sections.size() ? m_sections[i+1].offset : m_raw.size());
+        m_sections[i].size = end - m_sections[i].offset;
+    }
+
+    ::std::vector<uint8_t>  header(data_ofs);
+    memcpy(header.data(), RAW_MAGIC, sizeof(RAW_MAGIC));
+    put_u32(&header[8], static_cast<uint32_t>(m_sections.size()));
+    put_u32(&header[12], 0);
+    for(size_t i = 0; i < m_sections.size(); i ++)
+    {
+        auto* p = &header[RAW_HEADER_SIZE + RAW_SECTION_ENTRY_SIZE * i];
+        put_u32(p+0, static_cast<uint32_t>(m_sections[i].id));
+        put_u32(p+4, 0);
+        put_u64(p+8, data_ofs + m_sections[i].offset);
+        put_u64(p+16, m_sections[i].size);
+    }
+    m_backing.write( reinterpret_cast<const char*>(header.data()), header.size() );
+    m_backing.write( reinterpret_cast<const char*>(m_raw.data()), m_raw.size() );
 }
 
 void WriterInner::write(const void* buf, size_t len)
 {
+    if( !m_compress )
+    {
+        const auto* p = static_cast<const unsigned char*>(buf);
+        m_raw.insert(m_raw.end(), p, p + len);
+        return ;
+    }
     m_zstream.avail_in = len;
     m_zstream.next_in = reinterpret_cast<unsigned char*>( const_cast<void*>(buf) );
 
@@ -229,26 +410,116 @@ void ReadBuffer::populate(ReaderInner& is)
 
 
 Reader::Reader(const ::std::string& filename):
-    m_inner( new ReaderInner(filename) ),
+    m_inner(nullptr),
     m_buffer(1024),
-    m_pos(0)
+    m_pos(0),
+    m_mem_cur(nullptr),
+    m_mem_end(nullptr)
 {
+    uint8_t magic[sizeof(RAW_MAGIC)] = {0};
+    {
+        ::std::ifstream is(filename, ::std::ios_base::in|::std::ios_base::binary);
+        if( !is.is_open() )
+            throw ::std::runtime_error("Unable to open file");
+        is.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    }
+    if( memcmp(magic, RAW_MAGIC, sizeof(RAW_MAGIC)) == 0 )
+    {
+        m_mapping = ::std::make_shared<MappedFile>(filename);
+        const auto* base = m_mapping->data();
+        size_t size = m_mapping->size();
+        if( size < RAW_HEADER_SIZE )
+            throw ::std::runtime_error("Truncated HIR file header");
+        size_t n_sections = get_u32(base + 8);
+        if( size < RAW_HEADER_SIZE + RAW_SECTION_ENTRY_SIZE * n_sections )
+            throw ::std::runtime_error("Truncated HIR section directory");
+        for(size_t i = 0; i < n_sections; i ++)
+        {
+            const auto* p = base + RAW_HEADER_SIZE + RAW_SECTION_ENTRY_SIZE * i;
+            SectionEntry    e { static_cast<Section>(get_u32(p)), get_u64(p+8), get_u64(p+16) };
+            if( e.offset > size || e.size > size - e.offset )
+                throw ::std::runtime_error( FMT("HIR section " << section_name(e.id) << " out of bounds") );
+            m_sections.push_back(e);
+        }
+        this->enter_section(Section::Strings);
+    }
+    else
+    {
+        m_inner = new ReaderInner(filename);
+    }
+
     size_t n_strings = read_count();
-    m_strings.reserve(n_strings);
+    auto strings = ::std::make_shared<::std::vector<RcString>>();
+    strings->reserve(n_strings);
     DEBUG("n_strings = " << n_strings);
     for(size_t i = 0; i < n_strings; i ++)
     {
         auto s = read_string();
-        m_strings.push_back( RcString::new_interned(s) );
+        strings->push_back( RcString::new_interned(s) );
     }
+    m_strings = ::std::move(strings);
+}
+Reader::Reader(const uint8_t* data, size_t len, ::std::shared_ptr<const ::std::vector<RcString>> strings):
+    m_inner(nullptr),
+    m_buffer(0),
+    m_pos(0),
+    m_strings( ::std::move(strings) ),
+    m_mem_cur(data),
+    m_mem_end(data + len)
+{
 }
 Reader::~Reader()
 {
     delete m_inner, m_inner = nullptr;
 }
 
+void Reader::enter_section(Section s)
+{
+    if( !m_mapping )
+        return ;
+    for(const auto& e : m_sections)
+    {
+        if( e.id == s )
+        {
+            m_mem_cur = m_mapping->data() + e.offset;
+            m_mem_end = m_mem_cur + e.size;
+            m_pos = e.offset;
+            return ;
+        }
+    }
+    throw ::std::runtime_error( FMT("HIR file has no " << section_name(s) << " section") );
+}
+::std::shared_ptr<const uint8_t> Reader::read_shared(size_t len)
+{
+    if( m_mapping )
+    {
+        if( static_cast<size_t>(m_mem_end - m_mem_cur) < len )
+            throw ::std::runtime_error( FMT("Reader::read_shared - Requested " << len << " bytes, only " << (m_mem_end - m_mem_cur) << " left") );
+        // Shares ownership of the mapping
+        ::std::shared_ptr<const uint8_t> rv(m_mapping, m_mem_cur);
+        m_mem_cur += len;
+        m_pos += len;
+        return rv;
+    }
+    else
+    {
+        ::std::shared_ptr<uint8_t> rv(new uint8_t[len], ::std::default_delete<uint8_t[]>());
+        this->read(rv.get(), len);
+        return rv;
+    }
+}
+
 void Reader::read(void* buf, size_t len)
 {
+    if( !m_inner )
+    {
+        if( static_cast<size_t>(m_mem_end - m_mem_cur) < len )
+            throw ::std::runtime_error( FMT("Reader::read - Requested " << len << " bytes from memory, only " << (m_mem_end - m_mem_cur) << " left") );
+        memcpy(buf, m_mem_cur, len);
+        m_mem_cur += len;
+        m_pos += len;
+        return ;
+    }
     auto used = m_buffer.read(buf, len);
     if( used == len ) {
         m_pos += len;
@@ -273,6 +544,61 @@ void Reader::read(void* buf, size_t len)
 }
 
 
+MappedFile::MappedFile(const ::std::string& filename):
+    m_data(nullptr),
+    m_size(0)
+{
+#ifdef _WIN32
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if( m_file == INVALID_HANDLE_VALUE )
+        throw ::std::runtime_error("Unable to open file");
+    LARGE_INTEGER   size;
+    if( !GetFileSizeEx(m_file, &size) ) {
+        CloseHandle(m_file);
+        throw ::std::runtime_error("Unable to get file size");
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_map = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if( m_map == NULL ) {
+        CloseHandle(m_file);
+        throw ::std::runtime_error("Unable to map file");
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_map, FILE_MAP_READ, 0, 0, 0));
+    if( !m_data ) {
+        CloseHandle(m_map);
+        CloseHandle(m_file);
+        throw ::std::runtime_error("Unable to map file");
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if( fd < 0 )
+        throw ::std::runtime_error("Unable to open file");
+    struct stat st;
+    if( fstat(fd, &st) != 0 ) {
+        ::close(fd);
+        throw ::std::runtime_error("Unable to stat file");
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if( p == MAP_FAILED )
+        throw ::std::runtime_error("Unable to map file");
+    m_data = static_cast<const uint8_t*>(p);
+#endif
+}
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_map);
+    CloseHandle(m_file);
+#else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+
 ReaderInner::ReaderInner(const ::std::string& filename):
     m_backing(filename, ::std::ios_base::in|::std::ios_base::binary),
     m_zstream(),
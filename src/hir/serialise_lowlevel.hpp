@@ -17,10 +17,16 @@
 // 0xFD indicates start of a named object (string index follows)
 // 0xFE indicates start of an unnamed object
 // 0xFF indicates end of an object
+//
+// Container formats:
+// - Compressed (default): The whole stream is zlib compressed, and must be read sequentially.
+// - Uncompressed: A header (magic, section count), then a directory of sections (id, offset, size) followed by the raw
+//   stream. Intended to be memory-mapped, the reader uses the directory to find each section.
 
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 #include <stddef.h>
 #include <assert.h>
 #include <rc_string.hpp>
@@ -30,20 +36,52 @@ namespace serialise {
 
 class WriterInner;
 class ReaderInner;
+class MappedFile;
+
+/// Sections of a HIR file, in the order they're written
+enum class Section : uint32_t
+{
+    Strings,    // String table
+    Items,  // Crate header and root module
+    Impls,  // Type/trait/marker impls
+    Macros, // Exported macro names
+    Info,   // Lang items, extern crates and libraries
+    Mir,    // MIR bodies (offset table then the encoded bodies)
+};
+extern const char* section_name(Section s);
+struct SectionEntry
+{
+    Section id;
+    uint64_t    offset;
+    uint64_t    size;
+};
 
 class Writer
 {
     WriterInner*    m_inner;
     ::std::map<RcString, unsigned>  m_istring_cache;
     ::std::map<const char*, unsigned>  m_objname_cache;
+
+    // Active blob (see `start_blob`)
+    ::std::vector<uint8_t>* m_blob;
+    ::std::map<const char*, unsigned>  m_saved_objname_cache;
 public:
     Writer();
     Writer(const Writer&) = delete;
     Writer(Writer&&) = delete;
     ~Writer();
 
-    void open(const ::std::string& filename);
+    /// Open the output file (after the first pass has populated the string table)
+    /// - If `compress` is false, the uncompressed (mmap-able) container is written
+    void open(const ::std::string& filename, bool compress=true);
     void write(const void* data, size_t count);
+    /// Mark the start of a section (only recorded for the uncompressed format)
+    void start_section(Section s);
+
+    /// Redirect output into `out` until `end_blob`, used for data that is decoded separately from the main stream
+    /// - Strings still use the shared string table, but the object name cache is local to the blob
+    void start_blob(::std::vector<uint8_t>& out);
+    void end_blob();
 
     void write_u8(uint8_t v) {
         write(reinterpret_cast<const char*>(&v), 1);
@@ -227,11 +265,20 @@ class Reader
     ReaderInner*    m_inner;
     ReadBuffer  m_buffer;
     size_t  m_pos;
-    ::std::vector<RcString> m_strings;
+    ::std::shared_ptr<const ::std::vector<RcString>>    m_strings;
+
+    // In-memory source (if `m_inner` is null)
+    const uint8_t*  m_mem_cur;
+    const uint8_t*  m_mem_end;
+    // Backing for an uncompressed file (and its section directory)
+    ::std::shared_ptr<MappedFile>   m_mapping;
+    ::std::vector<SectionEntry> m_sections;
 
     ::std::vector<std::string>  m_objname_cache;
 public:
     Reader(const ::std::string& path);
+    /// Read a blob (see `Writer::start_blob`) from memory, using a string table from a file reader
+    Reader(const uint8_t* data, size_t len, ::std::shared_ptr<const ::std::vector<RcString>> strings);
     Reader(const Writer&) = delete;
     Reader(Writer&&) = delete;
     ~Reader();
@@ -239,6 +286,17 @@ public:
     size_t get_pos() const { return m_pos; }
     void read(void* dst, size_t count);
 
+    const ::std::shared_ptr<const ::std::vector<RcString>>& get_strings() const { return m_strings; }
+
+    /// Returns true if reading from a memory-mapped uncompressed file
+    bool is_mapped() const { return static_cast<bool>(m_mapping); }
+    /// Section directory (empty for compressed files)
+    const ::std::vector<SectionEntry>& sections() const { return m_sections; }
+    /// Move to the start of a section (a no-op for compressed files, which are read in order)
+    void enter_section(Section s);
+    /// Read `len` bytes that need to outlive the reader, avoiding a copy if the file is mapped
+    ::std::shared_ptr<const uint8_t> read_shared(size_t len);
+
     uint8_t read_u8() {
         uint8_t v;
         read(&v, sizeof v);
@@ -338,7 +396,7 @@ public:
     }
     RcString read_istring() {
         size_t idx = read_count();
-        return m_strings.at(idx);
+        return m_strings->at(idx);
     }
     ::std::string read_string() {
         size_t len = read_u8();
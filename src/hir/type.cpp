@@ -8,6 +8,8 @@
 #include "type.hpp"
 #include <span.hpp>
 #include "expr.hpp" // Hack for cloning array types
+#include <unordered_set>
+#include <mutex>
 
 namespace HIR {
 
@@ -274,6 +276,9 @@ bool ::HIR::TypeRef::operator==(const ::HIR::TypeRef& x) const
     
     if( !m_ptr || !x.m_ptr )
         return false;
+    // Equal interned types are always the same instance
+    if( m_ptr->m_interned && x.m_ptr->m_interned )
+        return false;
     if( data().tag() != x.data().tag() )
         return false;
 
@@ -363,6 +368,10 @@ Ordering HIR::TypeRef::ord(const ::HIR::TypeRef& x) const
 {
     Ordering    rv;
 
+    // NOTE: Can't shortcut unequal interned types, the ordering has to be structural (it's used to order output)
+    if( m_ptr == x.m_ptr )
+        return OrdEqual;
+
     ORD( static_cast<unsigned int>(data().tag()), static_cast<unsigned int>(x.data().tag()) );
 
     TU_MATCH(::HIR::TypeData, (data(), x.data()), (te, xe),
@@ -429,6 +438,286 @@ Ordering HIR::TypeRef::ord(const ::HIR::TypeRef& x) const
     )
     throw "";
 }
+
+namespace {
+    inline void hash_combine(size_t& h, size_t v) {
+        h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    void hash_params(size_t& h, const ::HIR::PathParams& pp) {
+        hash_combine(h, pp.m_types.size());
+        for(const auto& t : pp.m_types)
+            hash_combine(h, t.hash());
+    }
+    void hash_simplepath(size_t& h, const ::HIR::SimplePath& p) {
+        hash_combine(h, ::std::hash<RcString>()(p.m_crate_name));
+        for(const auto& c : p.m_components)
+            hash_combine(h, ::std::hash<RcString>()(c));
+    }
+    void hash_genericpath(size_t& h, const ::HIR::GenericPath& p) {
+        hash_simplepath(h, p.m_path);
+        hash_params(h, p.m_params);
+    }
+    void hash_path(size_t& h, const ::HIR::Path& p) {
+        hash_combine(h, static_cast<size_t>(p.m_data.tag()));
+        TU_MATCH_HDRA( (p.m_data), {)
+        TU_ARMA(Generic, pe) {
+            hash_genericpath(h, pe);
+            }
+        TU_ARMA(UfcsInherent, pe) {
+            hash_combine(h, pe.type.hash());
+            hash_combine(h, ::std::hash<RcString>()(pe.item));
+            hash_params(h, pe.params);
+            }
+        TU_ARMA(UfcsKnown, pe) {
+            hash_combine(h, pe.type.hash());
+            hash_genericpath(h, pe.trait);
+            hash_combine(h, ::std::hash<RcString>()(pe.item));
+            hash_params(h, pe.params);
+            }
+        TU_ARMA(UfcsUnknown, pe) {
+            hash_combine(h, pe.type.hash());
+            hash_combine(h, ::std::hash<RcString>()(pe.item));
+            hash_params(h, pe.params);
+            }
+        }
+    }
+
+    // Types that can be interned: must be fully known, and not mutated by later passes
+    bool params_are_internable(const ::HIR::PathParams& pp);
+    bool type_is_internable(const ::HIR::TypeRef& ty)
+    {
+        TU_MATCH_HDRA( (ty.data()), {)
+        TU_ARMA(Infer, e)   return false;
+        TU_ARMA(Closure, e) return false;
+        TU_ARMA(ErasedType, e)  return false;
+        TU_ARMA(Diverge, e) return true;
+        TU_ARMA(Primitive, e)   return true;
+        TU_ARMA(Generic, e) return true;
+        TU_ARMA(Path, e) {
+            if( e.binding.is_Unbound() )
+                return false;
+            TU_MATCH_HDRA( (e.path.m_data), {)
+            TU_ARMA(Generic, pe)
+                return params_are_internable(pe.m_params);
+            TU_ARMA(UfcsInherent, pe)
+                return type_is_internable(pe.type) && params_are_internable(pe.params) && params_are_internable(pe.impl_params);
+            TU_ARMA(UfcsKnown, pe)
+                return type_is_internable(pe.type) && params_are_internable(pe.trait.m_params) && params_are_internable(pe.params);
+            TU_ARMA(UfcsUnknown, pe)
+                return false;
+            }
+            }
+        TU_ARMA(TraitObject, e) {
+            if( !params_are_internable(e.m_trait.m_path.m_params) )
+                return false;
+            for(const auto& tb : e.m_trait.m_type_bounds)
+                if( !type_is_internable(tb.second.type) )
+                    return false;
+            for(const auto& m : e.m_markers)
+                if( !params_are_internable(m.m_params) )
+                    return false;
+            return true;
+            }
+        TU_ARMA(Array, e)
+            return !e.size.is_Unevaluated() && type_is_internable(e.inner);
+        TU_ARMA(Slice, e)
+            return type_is_internable(e.inner);
+        TU_ARMA(Tuple, e) {
+            for(const auto& t : e)
+                if( !type_is_internable(t) )
+                    return false;
+            return true;
+            }
+        TU_ARMA(Borrow, e)
+            return type_is_internable(e.inner);
+        TU_ARMA(Pointer, e)
+            return type_is_internable(e.inner);
+        TU_ARMA(Function, e) {
+            for(const auto& t : e.m_arg_types)
+                if( !type_is_internable(t) )
+                    return false;
+            return type_is_internable(e.m_rettype);
+            }
+        }
+        throw "";
+    }
+    bool params_are_internable(const ::HIR::PathParams& pp)
+    {
+        // NOTE: Value params aren't part of the ordering, so types with them can't be merged
+        if( !pp.m_values.empty() )
+            return false;
+        for(const auto& t : pp.m_types)
+            if( !type_is_internable(t) )
+                return false;
+        return true;
+    }
+
+    struct TypeInternHash {
+        size_t operator()(const ::HIR::TypeRef& t) const { return t.hash(); }
+    };
+    // NOTE: `operator==` and not `ord`, as the ordering ignores trait object lifetimes (which interning must keep)
+    struct TypeInternEq {
+        bool operator()(const ::HIR::TypeRef& a, const ::HIR::TypeRef& b) const { return a == b; }
+    };
+    struct TypeInternTable {
+        ::std::mutex    lock;
+        ::std::unordered_set<::HIR::TypeRef, TypeInternHash, TypeInternEq>  set;
+    };
+    TypeInternTable& get_intern_table() {
+        // NOTE: Leaked, so interned types stay valid during static destruction
+        static TypeInternTable* s_table = new TypeInternTable;
+        return *s_table;
+    }
+}
+
+size_t HIR::TypeRef::hash() const
+{
+    if( !m_ptr )
+        return 0;
+    if( m_ptr->m_interned )
+        return m_ptr->m_hash;
+
+    size_t  h = static_cast<size_t>(data().tag());
+    TU_MATCH_HDRA( (data()), {)
+    TU_ARMA(Infer, e) {
+        hash_combine(h, e.index);
+        }
+    TU_ARMA(Diverge, e) {
+        }
+    TU_ARMA(Primitive, e) {
+        hash_combine(h, static_cast<size_t>(e));
+        }
+    TU_ARMA(Path, e) {
+        hash_path(h, e.path);
+        }
+    TU_ARMA(Generic, e) {
+        hash_combine(h, e.binding);
+        }
+    TU_ARMA(TraitObject, e) {
+        hash_genericpath(h, e.m_trait.m_path);
+        hash_combine(h, e.m_markers.size());
+        }
+    TU_ARMA(ErasedType, e) {
+        // Only the origin is compared, don't bother hashing it
+        }
+    TU_ARMA(Array, e) {
+        hash_combine(h, e.inner.hash());
+        if( e.size.is_Known() )
+            hash_combine(h, static_cast<size_t>(e.size.as_Known()));
+        }
+    TU_ARMA(Slice, e) {
+        hash_combine(h, e.inner.hash());
+        }
+    TU_ARMA(Tuple, e) {
+        hash_combine(h, e.size());
+        for(const auto& t : e)
+            hash_combine(h, t.hash());
+        }
+    TU_ARMA(Borrow, e) {
+        hash_combine(h, static_cast<size_t>(e.type));
+        hash_combine(h, e.inner.hash());
+        }
+    TU_ARMA(Pointer, e) {
+        hash_combine(h, static_cast<size_t>(e.type));
+        hash_combine(h, e.inner.hash());
+        }
+    TU_ARMA(Function, e) {
+        hash_combine(h, e.is_unsafe);
+        hash_combine(h, e.m_arg_types.size());
+        for(const auto& t : e.m_arg_types)
+            hash_combine(h, t.hash());
+        hash_combine(h, e.m_rettype.hash());
+        }
+    TU_ARMA(Closure, e) {
+        hash_combine(h, reinterpret_cast<::std::uintptr_t>(e.node));
+        }
+    }
+    return h;
+}
+size_t HIR::Path::hash() const
+{
+    size_t  h = 0;
+    hash_path(h, *this);
+    return h;
+}
+
+::HIR::TypeRef HIR::TypeRef::interned() const
+{
+    if( !m_ptr || m_ptr->m_interned )
+        return this->clone();
+    if( !type_is_internable(*this) )
+        return this->clone();
+    return this->interned_unchecked();
+}
+::HIR::TypeRef HIR::TypeRef::interned_unchecked() const
+{
+    if( m_ptr->m_interned )
+        return this->clone();
+
+    // Make a copy with interned inner types (so the hash is cheap, and the inner types are shared too)
+    auto rv = this->clone_shallow();
+    auto intern_params = [](::HIR::PathParams& pp) {
+        for(auto& t : pp.m_types)
+            t = t.interned_unchecked();
+        };
+    TU_MATCH_HDRA( (rv.m_ptr->m_data), {)
+    default:
+        break;
+    TU_ARMA(Path, e) {
+        TU_MATCH_HDRA( (e.path.m_data), {)
+        TU_ARMA(Generic, pe) {
+            intern_params(pe.m_params);
+            }
+        TU_ARMA(UfcsInherent, pe) {
+            pe.type = pe.type.interned_unchecked();
+            intern_params(pe.params);
+            intern_params(pe.impl_params);
+            }
+        TU_ARMA(UfcsKnown, pe) {
+            pe.type = pe.type.interned_unchecked();
+            intern_params(pe.trait.m_params);
+            intern_params(pe.params);
+            }
+        TU_ARMA(UfcsUnknown, pe) {
+            pe.type = pe.type.interned_unchecked();
+            intern_params(pe.params);
+            }
+        }
+        }
+    TU_ARMA(Array, e) {
+        e.inner = e.inner.interned_unchecked();
+        }
+    TU_ARMA(Slice, e) {
+        e.inner = e.inner.interned_unchecked();
+        }
+    TU_ARMA(Tuple, e) {
+        for(auto& t : e)
+            t = t.interned_unchecked();
+        }
+    TU_ARMA(Borrow, e) {
+        e.inner = e.inner.interned_unchecked();
+        }
+    TU_ARMA(Pointer, e) {
+        e.inner = e.inner.interned_unchecked();
+        }
+    TU_ARMA(Function, e) {
+        for(auto& t : e.m_arg_types)
+            t = t.interned_unchecked();
+        e.m_rettype = e.m_rettype.interned_unchecked();
+        }
+    }
+    rv.m_ptr->m_hash = rv.hash();
+
+    auto& table = get_intern_table();
+    ::std::lock_guard<::std::mutex> lh { table.lock };
+    auto it = table.set.find(rv);
+    if( it != table.set.end() )
+        return it->clone();
+    rv.m_ptr->m_interned = true;
+    table.set.insert(rv.clone());
+    return rv;
+}
+
 #if 0
 bool ::HIR::TypeRef::contains_generics() const
 {
@@ -16,6 +16,7 @@
 #include "type_ref.hpp"
 #include "literal.hpp"
 #include "generic_ref.hpp"
+#include <atomic>
 
 constexpr const char* CLOSURE_PATH_PREFIX = "closure#";
 
@@ -202,12 +203,19 @@ public:
     // Existing TypeRef
 
 private:
-    unsigned    m_refcount;
+    // Atomic so types can be shared between worker threads (see parallel.hpp)
+    ::std::atomic<unsigned> m_refcount;
+    // Set if this is the shared instance from the intern table (see `TypeRef::interned`), which must not be mutated
+    bool    m_interned;
+    // Structural hash, only valid if `m_interned` is set
+    size_t  m_hash;
 public:
     TypeData   m_data;
 private:
     TypeInner(TypeData d):
         m_refcount(1),
+        m_interned(false),
+        m_hash(0),
         m_data(mv$(d))
     {
     }
@@ -230,8 +238,7 @@ inline TypeRef::~TypeRef()
 {
     if(m_ptr)
     {
-        m_ptr->m_refcount -= 1;
-        if(m_ptr->m_refcount == 0)
+        if(--m_ptr->m_refcount == 0)
         {
             delete m_ptr;
             m_ptr = nullptr;
@@ -239,8 +246,10 @@ inline TypeRef::~TypeRef()
     }
 }
 inline const TypeData& TypeRef::data() const { assert(m_ptr); return m_ptr->m_data; }
-inline TypeData& TypeRef::data_mut() { assert(m_ptr); return m_ptr->m_data; }
-inline TypeData& TypeRef::get_unique() { assert(m_ptr); if(m_ptr->m_refcount != 1) *this = this->clone_shallow(); return m_ptr->m_data; }
+// NOTE: Interned types are shared by all equal types, so are copied before being mutated
+inline TypeData& TypeRef::data_mut() { assert(m_ptr); if(m_ptr->m_interned) *this = this->clone_shallow(); return m_ptr->m_data; }
+inline TypeData& TypeRef::get_unique() { assert(m_ptr); if(m_ptr->m_refcount != 1 || m_ptr->m_interned) *this = this->clone_shallow(); return m_ptr->m_data; }
+inline bool TypeRef::is_interned() const { return m_ptr && m_ptr->m_interned; }
 
 
 inline TypeRef::TypeRef(::HIR::CoreType ct):
@@ -108,6 +108,15 @@ public:
     bool operator<(const ::HIR::TypeRef& x) const { return ord(x) == OrdLess; }
     Ordering ord(const ::HIR::TypeRef& x) const;
 
+    /// Structural hash (consistent with `==` and `ord`), cached for interned types
+    size_t hash() const;
+    /// Get the shared (hash-consed) instance of this type
+    /// - Only fully-resolved types are interned (no ivars, unevaluated array sizes, or unbound paths), others are
+    ///   just cloned.
+    /// - Equal interned types share the same `TypeInner`, so compare/hash in O(1)
+    TypeRef interned() const;
+    bool is_interned() const;
+
 
     //void match_generics(const Span& sp, const ::HIR::TypeRef& x_in, t_cb_resolve_type resolve_placeholder, MatchGenerics& callback) const;
     bool match_test_generics(const Span& sp, const ::HIR::TypeRef& x, t_cb_resolve_type resolve_placeholder, MatchGenerics& callback) const;
@@ -118,6 +127,17 @@ public:
     Compare compare_with_placeholders(const Span& sp, const ::HIR::TypeRef& x, t_cb_resolve_type resolve_placeholder) const;
 
     const ::HIR::SimplePath* get_sort_path() const;
+private:
+    TypeRef interned_unchecked() const;
 };
 
+}
+
+namespace std {
+    template<> struct hash<::HIR::TypeRef>
+    {
+        size_t operator()(const ::HIR::TypeRef& ty) const noexcept {
+            return ty.hash();
+        }
+    };
 }
\ No newline at end of file
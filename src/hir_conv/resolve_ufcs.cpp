@@ -791,7 +791,7 @@ namespace {
             }
             else
             {
-                ig.non_named.push_back(mv$(ty_impl));
+                ig.get_list_for_type_mut(type).push_back(mv$(ty_impl));
             }
             return true;
             });
@@ -816,7 +816,7 @@ void ConvertHIR_ResolveUFCS_SortImpls(::HIR::Crate& crate)
     sort_impl_group<HIR::TypeImpl>(crate.m_type_impls,
         [](::std::ostream& os, const HIR::TypeImpl& i){ os << "impl" << i.m_params.fmt_args() << " " << i.m_type; }
         );
-    DEBUG("Type impl counts: " << crate.m_type_impls.named.size() << " path groups, " << crate.m_type_impls.non_named.size() << " primitive, " << crate.m_type_impls.generic.size() << " ungrouped");
+    DEBUG("Type impl counts: " << crate.m_type_impls.named.size() << " path groups, " << crate.m_type_impls.non_named.size() << " primitive groups, " << crate.m_type_impls.generic.size() << " ungrouped");
     for(auto& impl_group : crate.m_trait_impls)
     {
         sort_impl_group<HIR::TraitImpl>(impl_group.second,
@@ -10,6 +10,8 @@
 #include <hir/hir.hpp>
 #include <hir/visitor.hpp>
 #include <algorithm>    // std::find_if
+#include <chrono>
+#include <time_report.hpp>
 
 #include <hir_typeck/static.hpp>
 #include "helpers.hpp"
@@ -6607,6 +6609,7 @@ namespace
 void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR::TypeRef& result_type, ::HIR::ExprPtr& expr)
 {
     TRACE_FUNCTION;
+    auto profile_start = ::std::chrono::steady_clock::now();
 
     auto root_ptr = expr.into_unique();
     assert(!ms.m_mod_paths.empty());
@@ -6614,6 +6617,7 @@ void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR:
 
     // - Build up ruleset from node tree
     Typecheck_Code_CS__EnumerateRules(context, ms, args, result_type, expr, root_ptr);
+    size_t initial_rules = context.link_coerce.size() + context.link_assoc.size() + context.to_visit.size();
 
     const unsigned int MAX_ITERATIONS = 1000;
     unsigned int count = 0;
@@ -7010,5 +7014,16 @@ void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR:
         }
         Typecheck_Expressions_ValidateOne(static_resolve, args, result_type, expr);
     }
+
+    if( ItemProfile_IsEnabled() )
+    {
+        ItemProfile_Record("Typecheck Expressions",
+            ms.m_item_path ? FMT(*ms.m_item_path) : FMT(expr->span()),
+            ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - profile_start).count(), {
+                { "passes", count },
+                { "rules", initial_rules },
+                { "ivars", context.m_ivars.m_ivars.size() },
+                });
+    }
 }
 
@@ -189,6 +189,7 @@ namespace {
         // ------
         void visit_function(::HIR::ItemPath p, ::HIR::Function& item) override {
             auto _ = this->m_ms.set_item_generics(item.m_params);
+            auto _p = this->m_ms.set_item_path(p);
             if( item.m_code )
             {
                 DEBUG("Function code " << p);
@@ -201,6 +202,7 @@ namespace {
         }
         void visit_static(::HIR::ItemPath p, ::HIR::Static& item) override {
             //auto _ = this->m_ms.set_item_generics(item.m_params);
+            auto _p = this->m_ms.set_item_path(p);
             if( item.m_value )
             {
                 DEBUG("Static value " << p);
@@ -210,6 +212,7 @@ namespace {
         }
         void visit_constant(::HIR::ItemPath p, ::HIR::Constant& item) override {
             auto _ = this->m_ms.set_item_generics(item.m_params);
+            auto _p = this->m_ms.set_item_path(p);
             if( item.m_value )
             {
                 DEBUG("Const value " << p);
@@ -219,6 +222,7 @@ namespace {
         }
         void visit_enum(::HIR::ItemPath p, ::HIR::Enum& item) override {
             auto _ = this->m_ms.set_item_generics(item.m_params);
+            auto _p = this->m_ms.set_item_path(p);
 
             if( auto* e = item.m_data.opt_Value() )
             {
@@ -19,10 +19,14 @@ namespace typeck {
         ::std::vector< ::std::pair< const ::HIR::SimplePath*, const ::HIR::Trait* > >   m_traits;
         ::std::vector<HIR::SimplePath>  m_mod_paths;
 
+        /// Path of the item currently being checked (for `-Z profile-items`), can be null
+        const ::HIR::ItemPath*  m_item_path;
+
         ModuleState(const ::HIR::Crate& crate):
             m_crate(crate),
             m_impl_generics(nullptr),
-            m_item_generics(nullptr)
+            m_item_generics(nullptr),
+            m_item_path(nullptr)
         {}
 
         template<typename T>
@@ -46,6 +50,10 @@ namespace typeck {
             m_item_generics = &gps;
             return NullOnDrop<const ::HIR::GenericParams>(m_item_generics);
         }
+        NullOnDrop<const ::HIR::ItemPath> set_item_path(const ::HIR::ItemPath& p) {
+            m_item_path = &p;
+            return NullOnDrop<const ::HIR::ItemPath>(m_item_path);
+        }
 
         void prepare_from_path(const ::HIR::ItemPath& ip);
 
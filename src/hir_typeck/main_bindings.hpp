@@ -6,6 +6,7 @@
  * - Functions in HIR typecheck called by main
  */
 #pragma once
+#include <iosfwd>
 
 namespace HIR {
     class Crate;
@@ -14,3 +15,6 @@ namespace HIR {
 extern void Typecheck_ModuleLevel(::HIR::Crate& crate);
 extern void Typecheck_Expressions(::HIR::Crate& crate);
 extern void Typecheck_Expressions_Validate(::HIR::Crate& crate);
+
+/// Print statistics from typecheck-level caches (`-Z print-stats`)
+extern void Typecheck_PrintStats(::std::ostream& os);
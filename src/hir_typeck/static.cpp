@@ -8,6 +8,8 @@
 #include "static.hpp"
 #include <algorithm>
 #include <hir/expr.hpp>
+#include <atomic>
+#include "main_bindings.hpp"
 
 void StaticTraitResolve::prep_indexes()
 {
@@ -17,6 +19,8 @@ void StaticTraitResolve::prep_indexes()
     TRACE_FUNCTION_F("");
 
     m_copy_cache.clear();
+    // Cached `find_impl` results are only valid for the bounds they were found with
+    m_impl_cache.clear();
     m_type_equalities.clear();
     m_trait_bounds.clear();
 
@@ -116,6 +120,72 @@ const ::HIR::TypeRef& StaticTraitResolve::get_const_param_type(const Span& sp, u
     return p->m_values.at(slot).m_type;
 }
 
+namespace {
+    // Stack of auto-trait queries being destructured (used to detect recursion in `find_impl`)
+    thread_local ::std::vector< ::std::tuple< const ::HIR::SimplePath*, const ::HIR::PathParams*, const ::HIR::TypeRef*> >    s_auto_trait_stack;
+
+    ::std::atomic<uint64_t> s_impl_cache_hits;
+    ::std::atomic<uint64_t> s_impl_cache_misses;
+
+    bool params_are_concrete(const ::HIR::PathParams& pp);
+    /// Returns true if the type can't change meaning with the in-scope generics/bounds (and can't be updated by inference)
+    bool type_is_concrete(const ::HIR::TypeRef& ty)
+    {
+        return !visit_ty_with(ty, [](const ::HIR::TypeRef& t)->bool {
+            TU_MATCH_HDRA( (t.data()), {)
+            default:
+                return false;
+            TU_ARMA(Generic, e)     return true;
+            TU_ARMA(Infer, e)       return true;
+            TU_ARMA(ErasedType, e)  return true;
+            TU_ARMA(Closure, e)     return true;
+            TU_ARMA(Array, e)       return !e.size.is_Known();
+            TU_ARMA(Path, e) {
+                if( e.binding.is_Unbound() || e.binding.is_Opaque() )
+                    return true;
+                if( const auto* pe = e.path.m_data.opt_Generic() )
+                    return !pe->m_params.m_values.empty();
+                return false;
+                }
+            }
+            return false;
+            });
+    }
+    bool params_are_concrete(const ::HIR::PathParams& pp)
+    {
+        if( !pp.m_values.empty() )
+            return false;
+        for(const auto& t : pp.m_types)
+            if( !type_is_concrete(t) )
+                return false;
+        return true;
+    }
+}
+
+size_t StaticTraitResolve::ImplCacheKeyHash::operator()(const ImplCacheKey& k) const
+{
+    size_t  h = k.type.hash();
+    h = h * 31 + ::std::hash<RcString>()(k.trait_path.m_components.empty() ? RcString() : k.trait_path.m_components.back());
+    for(const auto& t : k.trait_params.m_types)
+        h = h * 31 + t.hash();
+    return h;
+}
+
+void StaticTraitResolve::print_stats(::std::ostream& os)
+{
+    os << "find_impl cache: " << s_impl_cache_hits << " hits, " << s_impl_cache_misses << " misses" << ::std::endl;
+}
+void Typecheck_PrintStats(::std::ostream& os)
+{
+    StaticTraitResolve::print_stats(os);
+}
+
+// Wrapper around the actual search that memoises results for fully-concrete queries
+// - The search calls `found_cb` with each candidate in a deterministic order until it returns true, so the candidates
+//   are recorded and replayed to later callers. If an earlier caller stopped the search, the remainder is found by
+//   re-running the search and skipping the already-recorded candidates.
+// - Only searches that found nothing but impl blocks (and didn't use the in-scope bounds, even in a nested query) are
+//   cached, and the cache is cleared whenever the bounds change.
 bool StaticTraitResolve::find_impl(
     const Span& sp,
     const ::HIR::SimplePath& trait_path, const ::HIR::PathParams* trait_params,
@@ -123,6 +193,83 @@ bool StaticTraitResolve::find_impl(
     t_cb_find_impl found_cb,
     bool dont_handoff_to_specialised
     ) const
+{
+    // Results found while destructuring an auto trait may depend on the recursion assumption, so aren't cached.
+    if( !s_auto_trait_stack.empty() || !type_is_concrete(type) || (trait_params && !params_are_concrete(*trait_params)) )
+    {
+        return find_impl__uncached(sp, trait_path, trait_params, type, mv$(found_cb), dont_handoff_to_specialised);
+    }
+
+    ImplCacheKey    key {
+        trait_path.clone(),
+        trait_params != nullptr, trait_params ? trait_params->clone() : ::HIR::PathParams(),
+        type.interned(),
+        dont_handoff_to_specialised
+        };
+    size_t  skip = 0;
+    {
+        auto it = m_impl_cache.find(key);
+        if( it != m_impl_cache.end() )
+        {
+            const auto& ent = it->second;
+            for(const auto& r : ent.results)
+            {
+                if( found_cb(ImplRef(r.impl_params.clone(), trait_path, *r.impl), r.is_fuzzed) )
+                {
+                    s_impl_cache_hits ++;
+                    return true;
+                }
+            }
+            if( ent.complete )
+            {
+                s_impl_cache_hits ++;
+                return false;
+            }
+            skip = ent.results.size();
+        }
+    }
+    s_impl_cache_misses ++;
+
+    ::std::vector<ImplCacheResult>  results;
+    size_t  seen = 0;
+    bool cacheable = true;
+    auto bound_uses_before = m_bound_uses;
+    bool rv = find_impl__uncached(sp, trait_path, trait_params, type, [&](ImplRef ir, bool is_fuzzed)->bool {
+        if( seen ++ < skip )
+        {
+            // Already recorded (and rejected by this caller during the replay)
+            return false;
+        }
+        const auto* e = ir.m_data.opt_TraitImpl();
+        if( e && e->impl )
+            results.push_back(ImplCacheResult { e->impl_params.clone(), e->impl, is_fuzzed });
+        else
+            cacheable = false;
+        return found_cb(mv$(ir), is_fuzzed);
+        }, dont_handoff_to_specialised);
+
+    if( !cacheable || m_bound_uses != bound_uses_before )
+    {
+        return rv;
+    }
+    // NOTE: Looked up again, the search can recurse into `find_impl` and modify the cache.
+    auto& ent = m_impl_cache[mv$(key)];
+    if( ent.results.size() == skip )
+    {
+        for(auto& r : results)
+            ent.results.push_back(mv$(r));
+        ent.complete = !rv;
+    }
+    return rv;
+}
+
+bool StaticTraitResolve::find_impl__uncached(
+    const Span& sp,
+    const ::HIR::SimplePath& trait_path, const ::HIR::PathParams* trait_params,
+    const ::HIR::TypeRef& type,
+    t_cb_find_impl found_cb,
+    bool dont_handoff_to_specialised
+    ) const
 {
     TRACE_FUNCTION_F(trait_path << FMT_CB(os, if(trait_params) { os << *trait_params; } else { os << "<?>"; }) << " for " << type);
     auto cb_ident = [](const ::HIR::TypeRef&ty)->const ::HIR::TypeRef& { return ty; };
@@ -444,7 +591,10 @@ bool StaticTraitResolve::find_impl(
     // E.g. `T: IntoIterator<Item=&u8>` implies `<T as IntoIterator>::IntoIter : Iterator<Item=&u8>`
     for(const auto& b : m_trait_bounds)
     {
-        if( this->find_impl__check_bound(sp, trait_path, trait_params, type, found_cb,  b) )
+        if( this->find_impl__check_bound(sp, trait_path, trait_params, type, [&](ImplRef ir, bool is_fuzzed) {
+                note_bound_used();
+                return found_cb(mv$(ir), is_fuzzed);
+                },  b) )
         {
             DEBUG("Success");
             return true;
@@ -491,7 +641,7 @@ bool StaticTraitResolve::find_impl(
             return rv;
 
         // Detect recursion and return true if detected
-        static ::std::vector< ::std::tuple< const ::HIR::SimplePath*, const ::HIR::PathParams*, const ::HIR::TypeRef*> >    stack;
+        auto& stack = s_auto_trait_stack;
         for(const auto& ent : stack ) {
             if( *::std::get<0>(ent) != trait_path )
                 continue ;
@@ -504,7 +654,7 @@ bool StaticTraitResolve::find_impl(
         }
         stack.push_back( ::std::make_tuple( &trait_path, trait_params, &type ) );
         struct Guard {
-            ~Guard() { stack.pop_back(); }
+            ~Guard() { s_auto_trait_stack.pop_back(); }
         };
         Guard   _;
 
@@ -1285,6 +1435,7 @@ bool StaticTraitResolve::expand_associated_types__UfcsKnown(const Span& sp, ::HI
         }
     }
     if( rv ) {
+        note_bound_used();
         if( assume_opaque ) {
             input.data_mut().as_Path().binding = ::HIR::TypePathBinding::make_Opaque({});
             DEBUG("Assuming that " << input << " is an opaque name");
@@ -1574,6 +1725,7 @@ bool StaticTraitResolve::type_is_copy(const Span& sp, const ::HIR::TypeRef& ty)
         {
             auto pp = ::HIR::PathParams();
             if( this->find_impl__check_bound(sp, m_lang_Copy, &pp, ty, [&](auto , bool ){ return true; },  b) ) {
+                note_bound_used();
                 rv = true;
                 break;
             }
@@ -1693,6 +1845,7 @@ bool StaticTraitResolve::type_is_clone(const Span& sp, const ::HIR::TypeRef& ty)
         {
             auto pp = ::HIR::PathParams();
             if( this->find_impl__check_bound(sp, m_lang_Clone, &pp, ty, [&](auto , bool ){ return true; },  b) ) {
+                note_bound_used();
                 rv = true;
                 break;
             }
@@ -1896,6 +2049,7 @@ bool StaticTraitResolve::can_unsize(const Span& sp, const ::HIR::TypeRef& dst_ty
         const auto& be_dst = be_trait.m_path.m_params.m_types.at(0);
 
         if( src_ty == be_type && dst_ty == be_dst ) {
+            note_bound_used();
             return ::HIR::Compare::Equal;
         }
     }
@@ -10,6 +10,7 @@
 #include <hir/hir.hpp>
 #include "common.hpp"
 #include "impl_ref.hpp"
+#include <unordered_map>
 
 enum class MetadataType {
     Unknown,    // Unknown still
@@ -55,10 +56,44 @@ public:
     ::HIR::SimplePath   m_lang_PhantomData;
 
 private:
-    mutable ::std::map< ::HIR::TypeRef, bool >  m_copy_cache;
+    mutable ::std::unordered_map< ::HIR::TypeRef, bool >  m_copy_cache;
     mutable ::std::map< ::HIR::TypeRef, bool >  m_clone_cache;
     mutable ::std::map< ::HIR::TypeRef, bool >  m_drop_cache;
 
+    /// Memoised `find_impl` results for fully-concrete queries (see `find_impl`)
+    struct ImplCacheKey {
+        ::HIR::SimplePath   trait_path;
+        bool    has_params;
+        ::HIR::PathParams   trait_params;
+        ::HIR::TypeRef  type;
+        bool    dont_handoff_to_specialised;
+
+        bool operator==(const ImplCacheKey& x) const {
+            return has_params == x.has_params && dont_handoff_to_specialised == x.dont_handoff_to_specialised
+                && type == x.type && trait_path == x.trait_path && trait_params == x.trait_params;
+        }
+    };
+    struct ImplCacheKeyHash {
+        size_t operator()(const ImplCacheKey& k) const;
+    };
+    /// A `ImplRef::Data::TraitImpl` result (the only kind cached, as it doesn't borrow from the query or the bounds)
+    struct ImplCacheResult {
+        ::HIR::PathParams   impl_params;
+        const ::HIR::TraitImpl* impl;
+        bool    is_fuzzed;
+    };
+    struct ImplCacheEnt {
+        /// Results passed to the callback, in search order
+        ::std::vector<ImplCacheResult>  results;
+        /// If false, the search was stopped by the callback after the last entry in `results`
+        bool    complete = false;
+    };
+    mutable ::std::unordered_map<ImplCacheKey, ImplCacheEnt, ImplCacheKeyHash>  m_impl_cache;
+    /// Incremented whenever a result depends on the in-scope bounds (`m_trait_bounds`/`m_type_equalities`), so
+    /// `find_impl` knows not to cache a search that used them
+    mutable unsigned    m_bound_uses = 0;
+    void note_bound_used() const { m_bound_uses ++; }
+
 public:
     StaticTraitResolve(const ::HIR::Crate& crate):
         m_crate(crate),
@@ -150,7 +185,17 @@ public:
         bool dont_handoff_to_specialised = false
         ) const;
 
+    /// Print `find_impl` cache hit/miss counts (summed over all instances)
+    static void print_stats(::std::ostream& os);
+
 private:
+    bool find_impl__uncached(
+        const Span& sp,
+        const ::HIR::SimplePath& trait_path, const ::HIR::PathParams* trait_params,
+        const ::HIR::TypeRef& type,
+        t_cb_find_impl found_cb,
+        bool dont_handoff_to_specialised
+        ) const;
     bool find_impl__check_bound(
         const Span& sp,
         const ::HIR::SimplePath& trait_path, const ::HIR::PathParams* trait_params,
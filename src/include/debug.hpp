@@ -11,8 +11,10 @@
 #include <sstream>
 #include <cassert>
 #include <functional>
+#include <new>  // placement new
+#include <type_traits>
 
-extern int g_debug_indent_level;
+extern thread_local int g_debug_indent_level;
 
 #ifndef DEBUG_EXTRA_ENABLE
 # define DEBUG_EXTRA_ENABLE  // Files can override this with their own flag if needed (e.g. `&& g_my_debug_on`)
@@ -35,7 +37,9 @@ extern int g_debug_indent_level;
 # define TRACE_FUNCTION_FR(ss,ss2)  do{ if(false) (void)(::NullSink() << ss); if(false) (void)(::NullSink() << ss2); } while(0)
 #endif
 
-extern bool debug_enabled();
+// NOTE: Inline, as it's checked by every debug/trace macro
+extern bool g_debug_enabled;
+inline bool debug_enabled() { return g_debug_enabled; }
 extern ::std::ostream& debug_output(int indent, const char* function);
 
 struct RepeatLitStr
@@ -60,15 +64,58 @@ public:
     const NullSink& operator<<(const T&) const { return *this;  }
 };
 
+/// Function entry/exit logging (see `TRACE_FUNCTION` and friends)
+///
+/// `tag` is null if debug output is disabled, in which case nothing else is done (the callbacks are only called if it's
+/// enabled). The return callback is a by-reference lambda, so it's stored inline instead of in a `std::function`.
 class TraceLog
 {
     const char* m_tag;
-    ::std::function<void(::std::ostream&)>  m_ret;
+    alignas(void*) unsigned char m_ret[8*sizeof(void*)];
+    void (*m_ret_fcn)(const void* ret, ::std::ostream& os);
 public:
-    TraceLog(const char* tag, ::std::function<void(::std::ostream&)> info_cb, ::std::function<void(::std::ostream&)> ret);
-    TraceLog(const char* tag, ::std::function<void(::std::ostream&)> info_cb);
-    TraceLog(const char* tag);
-    ~TraceLog();
+    TraceLog(const char* tag):
+        m_tag(tag),
+        m_ret_fcn(nullptr)
+    {
+        if(m_tag) {
+            this->enter();
+        }
+    }
+    template<typename F>
+    TraceLog(const char* tag, const F& info_cb):
+        m_tag(tag),
+        m_ret_fcn(nullptr)
+    {
+        if(m_tag) {
+            auto& os = this->enter_start();
+            info_cb(os);
+            this->enter_end(os);
+        }
+    }
+    template<typename F, typename R>
+    TraceLog(const char* tag, const F& info_cb, const R& ret_cb):
+        TraceLog(tag, info_cb)
+    {
+        static_assert(sizeof(R) <= sizeof(m_ret) && alignof(R) <= alignof(void*), "TraceLog return callback too large");
+        static_assert(::std::is_trivially_copyable<R>::value && ::std::is_trivially_destructible<R>::value, "TraceLog return callback must capture by reference");
+        if(m_tag) {
+            new(m_ret) R(ret_cb);
+            m_ret_fcn = [](const void* ret, ::std::ostream& os) { (*static_cast<const R*>(ret))(os); };
+        }
+    }
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+    ~TraceLog() {
+        if(m_tag) {
+            this->exit();
+        }
+    }
+private:
+    void enter();
+    ::std::ostream& enter_start();
+    void enter_end(::std::ostream& os);
+    void exit();
 };
 
 struct FmtLambda
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <memory>
+#include <iosfwd>
 #include <ast/edition.hpp>
 
 namespace AST {
@@ -23,6 +24,10 @@ extern void Expand_Init();
 extern void Expand(::AST::Crate& crate);
 extern void Expand_TestHarness(::AST::Crate& crate);
 extern void Expand_ProcMacro(::AST::Crate& crate);
+/// Start collecting per-macro `macro_rules!` statistics (not collected by default, as it's on the expansion hot path)
+extern void Macro_EnableStats();
+/// Print per-macro `macro_rules!` match cache statistics (`-Z print-stats`)
+extern void Macro_PrintStats(::std::ostream& os);
 
 /// Dump the crate AST as annotated rust
 extern void Dump_Rust(const char *Filename, const AST::Crate& crate);
@@ -0,0 +1,29 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * include/parallel.hpp
+ * - Simple worker pool for running independent per-item work across threads
+ */
+#pragma once
+#include <functional>
+#include <cstddef>
+
+/// Set the number of worker threads used by parallel phases (`-j`/`$MRUSTC_THREADS`)
+/// - A count of 0 or 1 runs everything on the calling thread
+extern void Parallel_SetThreadCount(unsigned count);
+extern unsigned Parallel_GetThreadCount();
+
+/// Call `cb(worker, idx)` for every `idx` in `0 .. count`, spread over the worker pool
+///
+/// `worker` is in `0 .. Parallel_GetThreadCount()` and is unique among concurrently running callbacks, so can be used
+/// to index per-worker state. Indexes are handed out in increasing order. If any callback throws, remaining items are
+/// skipped and the exception from the lowest index is re-thrown on the calling thread once all workers have stopped.
+extern void Parallel_ForEach(size_t count, ::std::function<void(unsigned worker, size_t idx)> cb);
+
+/// Join the GNU make jobserver from `$MAKEFLAGS` (e.g. when run by minicargo or `make -j`), or create one for child
+/// processes if there isn't one and multiple threads are in use
+extern void Parallel_InitJobServer();
+/// As `Parallel_ForEach`, but for callbacks that run an external process (e.g. the C compiler)
+/// - Each callback holds a jobserver slot while it runs, and with a jobserver the worker count is its slot count
+extern void Parallel_ForEachJob(size_t count, ::std::function<void(unsigned worker, size_t idx)> cb);
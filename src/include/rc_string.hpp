@@ -9,11 +9,23 @@
 
 #include <cstring>
 #include <ostream>
+#include <atomic>
+#include <functional>   // std::hash
 #include "../common.hpp"
 
 class RcString
 {
-    unsigned int*   m_ptr;
+    struct Inner {
+        // Atomic so strings can be shared between worker threads (see parallel.hpp)
+        ::std::atomic<unsigned> refcount;
+        unsigned    size;
+        /// Hash of the contents (see `std::hash<RcString>`), computed on creation
+        size_t  hash;
+        /// Set on the instance held by the intern table, two different interned instances are never equal
+        bool    interned;
+        char    data[1];
+    };
+    Inner*  m_ptr;
 public:
     RcString():
         m_ptr(nullptr)
@@ -30,11 +42,14 @@ public:
 
     static RcString new_interned(const ::std::string& s);
     static RcString new_interned(const char* s);
+private:
+    static RcString intern(RcString s);
+public:
 
     RcString(const RcString& x):
         m_ptr(x.m_ptr)
     {
-        if( m_ptr ) *m_ptr += 1;
+        if( m_ptr ) m_ptr->refcount += 1;
     }
     RcString(RcString&& x):
         m_ptr(x.m_ptr)
@@ -50,7 +65,7 @@ public:
         {
             this->~RcString();
             m_ptr = x.m_ptr;
-            if( m_ptr ) *m_ptr += 1;
+            if( m_ptr ) m_ptr->refcount += 1;
         }
         return *this;
     }
@@ -68,11 +83,11 @@ public:
     const char* begin() const { return c_str(); }
     const char* end() const { return c_str() + size(); }
 
-    size_t size() const { return m_ptr ? m_ptr[1] : 0; }
+    size_t size() const { return m_ptr ? m_ptr->size : 0; }
     const char* c_str() const {
         if( m_ptr )
         {
-            return reinterpret_cast<const char*>(m_ptr + 2);
+            return m_ptr->data;
         }
         else
         {
@@ -80,6 +95,9 @@ public:
         }
     }
 
+    /// Returns true if this is the intern table's instance of the string
+    bool is_interned() const { return m_ptr && m_ptr->interned; }
+
     char back() const {
         assert(size() > 0 );
         return *(c_str() + size() - 1);
@@ -92,14 +110,19 @@ public:
         return ord(s.c_str(), s.size());
     }
     bool operator==(const RcString& s) const {
-        if(s.size() != this->size())
+        if( m_ptr == s.m_ptr )
+            return true;
+        // NOTE: Non-null strings are never empty
+        if( !m_ptr || !s.m_ptr )
+            return false;
+        if( m_ptr->interned && s.m_ptr->interned )
             return false;
-        return this->ord(s) == OrdEqual;
+        if( m_ptr->size != s.m_ptr->size || m_ptr->hash != s.m_ptr->hash )
+            return false;
+        return ::std::memcmp(m_ptr->data, s.m_ptr->data, m_ptr->size) == 0;
     }
     bool operator!=(const RcString& s) const {
-        if(s.size() != this->size())
-            return true;
-        return this->ord(s) != OrdEqual;
+        return !(*this == s);
     }
     bool operator<(const RcString& s) const { return this->ord(s) == OrdLess; }
     bool operator>(const RcString& s) const { return this->ord(s) == OrdGreater; }
@@ -115,6 +138,7 @@ public:
     bool operator!=(const char* s) const { return this->ord(s) != OrdEqual; }
 
     friend ::std::ostream& operator<<(::std::ostream& os, const RcString& x);
+    friend struct ::std::hash<RcString>;
 
     friend bool operator==(const char* a, const RcString& b) {
         return b == a;
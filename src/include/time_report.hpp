@@ -0,0 +1,58 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * include/time_report.hpp
+ * - Compile-time profiling (`--time-report` and `-Z profile-items`)
+ */
+#pragma once
+#include <string>
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <initializer_list>
+
+/// Start recording phase timings/memory and counters (all other calls are no-ops until this is called)
+extern void TimeReport_Enable();
+extern bool TimeReport_IsEnabled();
+
+/// Record the start/end of a compiler phase (used by `CompilePhase`)
+extern void TimeReport_PhaseBegin(const char* name);
+extern void TimeReport_PhaseEnd();
+/// Record the memory usage at a named point (used by `memory_dump`)
+extern void TimeReport_Checkpoint(const char* name);
+
+/// Add to a named counter (e.g. number of MIR functions), thread-safe
+extern void TimeReport_AddCount(const char* name, uint64_t count);
+
+/// Write the collected report as JSON, returns false if the file can't be written
+extern bool TimeReport_Write(const ::std::string& path, const ::std::string& crate_name);
+
+/// Enable per-item profiling (`-Z profile-items[=<n>]`), printing the `top_n` slowest items in each category
+extern void ItemProfile_Enable(unsigned top_n);
+extern bool ItemProfile_IsEnabled();
+/// Record the cost of processing one item (e.g. typechecking a function), thread-safe
+/// - Repeated records for the same item are merged: times are summed, `counters` keep the maximum seen
+extern void ItemProfile_Record(const char* category, const ::std::string& item, double seconds, ::std::initializer_list<::std::pair<const char*, uint64_t>> counters);
+/// Print the slowest items in each category
+extern void ItemProfile_Print(::std::ostream& os);
+
+/// RAII helper for `TimeReport_PhaseBegin`/`TimeReport_PhaseEnd`
+class TimeReportPhase
+{
+    bool    m_active;
+public:
+    TimeReportPhase(const char* name):
+        m_active(TimeReport_IsEnabled())
+    {
+        if(m_active)
+            TimeReport_PhaseBegin(name);
+    }
+    ~TimeReportPhase()
+    {
+        if(m_active)
+            TimeReport_PhaseEnd();
+    }
+    TimeReportPhase(const TimeReportPhase&) = delete;
+    TimeReportPhase& operator=(const TimeReportPhase&) = delete;
+};
@@ -16,6 +16,10 @@
 #include <ast/expr.hpp>
 #include <ast/crate.hpp>
 #include <hir/hir.hpp>  // HIR::Crate
+#include <main_bindings.hpp>    // Macro_PrintStats
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
 
  // Map of: LoopIndex=>(Path=>Count)
 typedef std::map<unsigned, std::map< std::vector<unsigned>, unsigned > >    loop_counts_t;
@@ -168,7 +172,7 @@ public:
 };
 
 // === Prototypes ===
-unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& rules, TokenTree input, const AST::Crate& crate, AST::Module& mod,  ParameterMappings& bound_tts);
+unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& rules, TokenTree input, const AST::Crate& crate, AST::Module& mod,  ParameterMappings& bound_tts, bool& out_cache_hit);
 void Macro_InvokeRules_CountSubstUses(ParameterMappings& bound_tts, const ::std::vector<MacroExpansionEnt>& contents);
 
 // ------------------------------------
@@ -529,14 +533,68 @@ InterpolatedFragment Macro_HandlePatternCap(TokenStream& lex, MacroPatEnt::Type
     throw "";
 }
 
+namespace {
+    /// Per-macro statistics for `-Z print-stats`
+    struct MacroStats {
+        ::std::string   name;
+        unsigned    invocations = 0;
+        unsigned    cache_hits = 0;
+        ::std::chrono::steady_clock::duration   match_time {};
+    };
+    bool    s_macro_stats_enabled = false;
+    ::std::unordered_map<const MacroRules*, MacroStats>   s_macro_stats;
+}
+
+void Macro_EnableStats()
+{
+    s_macro_stats_enabled = true;
+}
+void Macro_PrintStats(::std::ostream& os)
+{
+    typedef ::std::chrono::duration<double, ::std::milli>   ms_t;
+    ::std::vector<::std::pair<const ::std::string*, const MacroStats*>> sorted;
+    MacroStats  total;
+    for(const auto& e : s_macro_stats)
+    {
+        sorted.push_back(::std::make_pair(&e.second.name, &e.second));
+        total.invocations += e.second.invocations;
+        total.cache_hits += e.second.cache_hits;
+        total.match_time += e.second.match_time;
+    }
+    ::std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){ return a.second->match_time > b.second->match_time; });
+
+    os << "macro_rules match cache: " << total.cache_hits << "/" << total.invocations << " hits, "
+        << ms_t(total.match_time).count() << "ms matching" << ::std::endl;
+    const size_t MAX_SHOWN = 20;
+    for(size_t i = 0; i < ::std::min(sorted.size(), MAX_SHOWN); i ++)
+    {
+        const auto& st = *sorted[i].second;
+        os << "- " << *sorted[i].first << "!: " << st.cache_hits << "/" << st.invocations << " hits, "
+            << ms_t(st.match_time).count() << "ms" << ::std::endl;
+    }
+}
+
 /// Parse the input TokenTree according to the `macro_rules!` patterns and return a token stream of the replacement
 ::std::unique_ptr<TokenStream> Macro_InvokeRules(const char *name, const MacroRules& rules, const Span& sp, TokenTree input, const AST::Crate& crate, AST::Module& mod)
 {
     TRACE_FUNCTION_F("'" << name << "', " << input);
     DEBUG("rules.m_hygiene = " << rules.m_hygiene);
 
+    ::std::chrono::steady_clock::time_point start_time;
+    if( s_macro_stats_enabled )
+        start_time = ::std::chrono::steady_clock::now();
     ParameterMappings   bound_tts;
-    unsigned int    rule_index = Macro_InvokeRules_MatchPattern(sp, rules, mv$(input), crate, mod,  bound_tts);
+    bool    cache_hit = false;
+    unsigned int    rule_index = Macro_InvokeRules_MatchPattern(sp, rules, mv$(input), crate, mod,  bound_tts, cache_hit);
+    if( s_macro_stats_enabled )
+    {
+        auto& st = s_macro_stats[&rules];
+        if( st.name.empty() )
+            st.name = name;
+        st.invocations += 1;
+        st.cache_hits += (cache_hit ? 1 : 0);
+        st.match_time += ::std::chrono::steady_clock::now() - start_time;
+    }
 
     const auto& rule = rules.m_rules.at(rule_index);
 
@@ -1804,113 +1862,199 @@ namespace
     }
 }
 
-unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& rules, TokenTree input, const AST::Crate& crate, AST::Module& mod,  ParameterMappings& bound_tts)
+namespace
 {
-    TRACE_FUNCTION_F(rules.m_rules.size() << " options");
-    ASSERT_BUG(sp, rules.m_rules.size() > 0, "Empty macro_rules set");
-
-    ::std::vector< ::std::pair<size_t, ::std::vector<bool>> >    matches;
-    ::std::vector< std::pair<size_t, eTokenType> >  fail_pos;
-    for(size_t i = 0; i < rules.m_rules.size(); i ++)
+    bool is_interpolated(eTokenType ty)
     {
-        auto lex = TokenStreamRO(input);
-        auto arm_stream = MacroPatternStream(rules.m_rules[i].m_pattern);
+        return TOK_INTERPOLATED_PATH <= ty && ty <= TOK_INTERPOLATED_VIS;
+    }
+    // Collect the leaf tokens of a TokenTree (in the order that `TokenStreamRO` visits them)
+    void flatten_tokens(const TokenTree& tt, ::std::vector<const Token*>& out)
+    {
+        if( tt.is_token() )
+        {
+            out.push_back(&tt.tok());
+        }
+        else
+        {
+            for(size_t i = 0; i < tt.size(); i ++)
+                flatten_tokens(tt[i], out);
+        }
+    }
+    // Hash of the token sequence seen by arm selection (see `MacroRulesMatchCache`)
+    size_t hash_match_tokens(const ::std::vector<const Token*>& toks)
+    {
+        size_t  h = toks.size();
+        for(const auto* tp : toks)
+            h = h * 1000003 ^ tp->hash();
+        return h;
+    }
+    bool match_tokens_equal(const ::std::vector<MacroRulesMatchCache::KeyTok>& key, const ::std::vector<const Token*>& toks)
+    {
+        if( key.size() != toks.size() )
+            return false;
+        for(size_t i = 0; i < key.size(); i ++)
+        {
+            if( key[i].type != toks[i]->type() )
+                return false;
+            if( !is_interpolated(key[i].type) && key[i].tok != *toks[i] )
+                return false;
+        }
+        return true;
+    }
 
-        bool fail = false;
-        for(;;)
+    /// Determine which arm of `rules` matches `input`, returning the arm index and the `If` history for replay
+    unsigned int Macro_InvokeRules_SelectArm(const Span& sp, const MacroRules& rules, const TokenTree& input, ::std::vector<bool>& out_history)
+    {
+        ::std::vector< std::pair<size_t, eTokenType> >  fail_pos;
+        for(size_t i = 0; i < rules.m_rules.size(); i ++)
         {
-            const auto pos = arm_stream.cur_pos();
-            const auto& pat = arm_stream.next();
-            // NOTE: The positions seen by this aren't fully sequential, as `next` steps over jumps/loop control ops
-            DEBUG("Arm " << i << " @" << pos << " " << pat);
-            if(pat.is_End())
-            {
-                if( lex.next() != TOK_EOF )
-                    fail = true;
-                break;
-            }
-            else if( const auto* e = pat.opt_If() )
+            auto lex = TokenStreamRO(input);
+            auto arm_stream = MacroPatternStream(rules.m_rules[i].m_pattern);
+
+            bool fail = false;
+            for(;;)
             {
-                auto lc = lex.clone();
-                bool rv = true;
-                for(const auto& check : e->ents)
+                const auto pos = arm_stream.cur_pos();
+                const auto& pat = arm_stream.next();
+                // NOTE: The positions seen by this aren't fully sequential, as `next` steps over jumps/loop control ops
+                DEBUG("Arm " << i << " @" << pos << " " << pat);
+                if(pat.is_End())
+                {
+                    if( lex.next() != TOK_EOF )
+                        fail = true;
+                    break;
+                }
+                else if( const auto* e = pat.opt_If() )
                 {
-                    if( check.ty != MacroPatEnt::PAT_TOKEN ) {
-                        if( !consume_from_frag(lc, check.ty)  )
+                    auto lc = lex.clone();
+                    bool rv = true;
+                    for(const auto& check : e->ents)
+                    {
+                        if( check.ty != MacroPatEnt::PAT_TOKEN ) {
+                            if( !consume_from_frag(lc, check.ty)  )
+                            {
+                                rv = false;
+                                break;
+                            }
+                        }
+                        else
                         {
-                            rv = false;
-                            break;
+                            if( lc.next_tok() != check.tok )
+                            {
+                                rv = false;
+                                break;
+                            }
+                            if( lc.next_tok() != TOK_EOF )
+                                lc.consume();
                         }
                     }
-                    else
+                    if( rv == e->is_equal )
                     {
-                        if( lc.next_tok() != check.tok )
-                        {
-                            rv = false;
-                            break;
-                        }
-                        if( lc.next_tok() != TOK_EOF )
-                            lc.consume();
+                        DEBUG("- Succeeded");
+                        arm_stream.if_succeeded();
                     }
                 }
-                if( rv == e->is_equal )
+                else if( const auto* e = pat.opt_ExpectTok() )
                 {
-                    DEBUG("- Succeeded");
-                    arm_stream.if_succeeded();
+                    const auto& tok = lex.next_tok();
+                    DEBUG("Arm " << i << " @" << pos << " ExpectTok(" << *e << ") == " << tok);
+                    if( tok != *e )
+                    {
+                        fail = true;
+                        break;
+                    }
+                    lex.consume();
                 }
-            }
-            else if( const auto* e = pat.opt_ExpectTok() )
-            {
-                const auto& tok = lex.next_tok();
-                DEBUG("Arm " << i << " @" << pos << " ExpectTok(" << *e << ") == " << tok);
-                if( tok != *e )
+                else if( const auto* e = pat.opt_ExpectPat() )
                 {
-                    fail = true;
-                    break;
+                    DEBUG("Arm " << i << " @" << pos << " ExpectPat(" << e->type << " => $" << e->idx << ")");
+                    if( !consume_from_frag(lex, e->type) )
+                    {
+                        fail = true;
+                        break;
+                    }
                 }
-                lex.consume();
-            }
-            else if( const auto* e = pat.opt_ExpectPat() )
-            {
-                DEBUG("Arm " << i << " @" << pos << " ExpectPat(" << e->type << " => $" << e->idx << ")");
-                if( !consume_from_frag(lex, e->type) )
+                else
                 {
-                    fail = true;
-                    break;
+                    // Unreachable.
                 }
             }
+
+
+            if( ! fail )
+            {
+                // NOTE: There can be multiple arms active, take the first.
+                DEBUG(i << " MATCHED");
+                out_history = arm_stream.take_history();
+                return i;
+            }
             else
             {
-                // Unreachable.
+                DEBUG(i << " FAILED");
+                fail_pos.push_back( std::make_pair(lex.position(), lex.next()) );
             }
         }
 
+        // ERROR!
+        // TODO: Keep track of where each arm failed.
+        TODO(sp, "No arm matched - " << fail_pos);
+    }
+}
 
-        if( ! fail )
-        {
-            matches.push_back( ::std::make_pair(i, arm_stream.take_history()) );
-            DEBUG(i << " MATCHED");
-        }
-        else
+unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& rules, TokenTree input, const AST::Crate& crate, AST::Module& mod,  ParameterMappings& bound_tts, bool& out_cache_hit)
+{
+    TRACE_FUNCTION_F(rules.m_rules.size() << " options");
+    ASSERT_BUG(sp, rules.m_rules.size() > 0, "Empty macro_rules set");
+
+    // Look up the arm selection cache
+    ::std::vector<const Token*> input_toks;
+    flatten_tokens(input, input_toks);
+    auto input_hash = hash_match_tokens(input_toks);
+
+    auto& cache = rules.m_match_cache;
+    const MacroRulesMatchCache::Ent* cache_ent = nullptr;
+    auto range = cache.entries.equal_range(input_hash);
+    for(auto it = range.first; it != range.second; ++ it)
+    {
+        if( match_tokens_equal(it->second.input, input_toks) )
         {
-            DEBUG(i << " FAILED");
-            fail_pos.push_back( std::make_pair(lex.position(), lex.next()) );
+            cache_ent = &it->second;
+            break;
         }
     }
 
-    if( matches.size() == 0 )
+    unsigned int i;
+    ::std::vector<bool> history_buf;
+    out_cache_hit = (cache_ent != nullptr);
+    if( cache_ent )
     {
-        // ERROR!
-        // TODO: Keep track of where each arm failed.
-        TODO(sp, "No arm matched - " << fail_pos);
+        DEBUG("Cached arm " << cache_ent->arm_index);
+        i = cache_ent->arm_index;
     }
     else
     {
-        // yay!
+        i = Macro_InvokeRules_SelectArm(sp, rules, input, history_buf);
+        if( !cache.seen_hashes.insert(input_hash).second )
+        {
+            MacroRulesMatchCache::Ent   ent;
+            ent.input.reserve(input_toks.size());
+            for(const auto* tp : input_toks)
+            {
+                if( is_interpolated(tp->type()) )
+                    ent.input.push_back(MacroRulesMatchCache::KeyTok { tp->type(), Token() });
+                else
+                    ent.input.push_back(MacroRulesMatchCache::KeyTok { tp->type(), *tp });
+            }
+            ent.arm_index = i;
+            ent.history = mv$(history_buf);
+            cache_ent = &cache.entries.insert(::std::make_pair(input_hash, mv$(ent)))->second;
+        }
+    }
+    input_toks.clear();
+    const auto& history = cache_ent ? cache_ent->history : history_buf;
 
-        // NOTE: There can be multiple arms active, take the first.
-        auto i = matches[0].first;
-        const auto& history = matches[0].second;
+    {
         DEBUG("Evalulating arm " << i);
 
         auto lex = TTStreamO(sp, ParseState(crate.m_edition), mv$(input));
@@ -16,6 +16,8 @@
 #include <cstring>
 #include "macro_rules_ptr.hpp"
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 class MacroExpander;
 class SimplePatEnt;
@@ -175,6 +177,29 @@ struct MacroRulesArm
     MacroRulesArm& operator=(MacroRulesArm&&) = default;
 };
 
+/// Memoised arm selections for a `macro_rules!` block
+/// - Arm selection only depends on the types and values of the input tokens (not on spans, hygiene, or the
+///   contents of interpolated fragments), so the result can be reused for any input with the same token sequence.
+struct MacroRulesMatchCache
+{
+    struct KeyTok {
+        eTokenType  type;
+        /// Copy of the token, TOK_NULL for interpolated fragments (only the type is checked)
+        Token   tok;
+    };
+    struct Ent {
+        ::std::vector<KeyTok>   input;
+        unsigned int    arm_index;
+        /// `If` condition history for `MacroPatternStream` replay
+        ::std::vector<bool> history;
+    };
+
+    /// Hashes of inputs seen once - an entry is only stored on the second sighting, to avoid keeping a copy of
+    /// every step of a recursive tt-muncher.
+    ::std::unordered_set<size_t>   seen_hashes;
+    ::std::unordered_multimap<size_t, Ent>  entries;
+};
+
 /// A sigle 'macro_rules!' block
 class MacroRules
 {
@@ -191,6 +216,9 @@ public:
     /// Expansion rules
     ::std::vector<MacroRulesArm>  m_rules;
 
+    /// Cache of arm selections (populated by `Macro_InvokeRules`)
+    mutable MacroRulesMatchCache    m_match_cache;
+
     MacroRules()
     {
     }
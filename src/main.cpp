@@ -7,6 +7,7 @@
  */
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <string>
 #include <set>
 #include <version.hpp>
@@ -30,11 +31,16 @@
 #include "expand/cfg.hpp"
 #include <target_detect.h>	// tools/common/target_detect.h
 #include <debug_inner.hpp>
+#include <parallel.hpp>
+#include <time_report.hpp>
 
 #ifdef _WIN32
 # define NOGDI
 # include <Windows.h>
 # include <DbgHelp.h>
+#else
+# include <unistd.h>   // write/close
+# include <cerrno>
 #endif
 
 TargetVersion	gTargetVersion = TargetVersion::Rustc1_29;
@@ -66,6 +72,16 @@ struct ProgramParams
     unsigned opt_level = 0;
     bool emit_debug_info = false;
 
+    // Number of worker threads to use for parallel phases (`-j`/`$MRUSTC_THREADS`)
+    unsigned num_threads = 1;
+    // Write crate metadata in the uncompressed (memory-mappable) format (`-Z hir-uncompressed`/`$MRUSTC_HIR_UNCOMPRESSED`)
+    bool hir_uncompressed = false;
+    // If non-empty, write per-phase timing/memory and item counts to this file as JSON (`--time-report=<file>`)
+    ::std::string   time_report_file;
+    // Pipe to write a byte to once the crate metadata (`.hir`) is saved, so a build tool can start dependent crates
+    // while this one is still generating code (`$MRUSTC_METADATA_FD`, set by minicargo)
+    int metadata_fd = -1;
+
     bool test_harness = false;
 
     // NOTE: If populated, nothing happens except for loading the target
@@ -81,17 +97,22 @@ struct ProgramParams
 
     struct {
         bool disable_mir_optimisations = false;
+        bool disable_fold_identical = false;
         bool full_validate = false;
         bool full_validate_early = false;
 
         bool dump_ast = false;
         bool dump_hir = false;
         bool dump_mir = false;
+
+        bool print_stats = false;
     } debug;
     struct {
         ::std::string   codegen_type;
         ::std::string   emit_build_command;
         ::std::string   panic_type;
+        unsigned    codegen_units = 1;
+        ::std::string   object_cache_dir;
     } codegen;
 
     ProgramParams(int argc, char *argv[]);
@@ -102,11 +123,13 @@ struct ProgramParams
 template <typename Rv, typename Fcn>
 Rv CompilePhase(const char *name, Fcn f) {
     DebugTimedPhase timed_phase(name);
+    TimeReportPhase report_phase(name);
     return f();
 }
 template <typename Fcn>
 void CompilePhaseV(const char *name, Fcn f) {
     DebugTimedPhase timed_phase(name);
+    TimeReportPhase report_phase(name);
     f();
 }
 
@@ -152,6 +175,7 @@ void init_debug_list()
         "MIR Validate",
         "MIR Validate Full Early",
         "Dump MIR",
+        "Free HIR Expressions",
         "Constant Evaluate Full",
         "MIR Cleanup",
         "MIR Optimise",
@@ -167,11 +191,13 @@ void init_debug_list()
         "MIR Optimise Inline PM",
         "MIR Optimise Inline",
         "Trans Enumerate Cleanup",
+        "Trans Fold Identical",
         "Trans Codegen"
         });
 }
 
 void memory_dump(const char* phase) {
+    TimeReport_Checkpoint(phase);
 #ifdef _MSC_VER
 #pragma comment(lib, "dbghelp.lib")
     if( getenv("MRUSTC_DUMPMEM") )
@@ -228,11 +254,49 @@ void memory_dump(const char* phase) {
     }
 }
 
+/// Tell the build tool that the metadata is ready (see `ProgramParams::metadata_fd`)
+void signal_metadata_ready(int fd)
+{
+#ifndef _WIN32
+    if( fd >= 0 )
+    {
+        // NOTE: Errors are ignored, the build tool falls back to waiting for this process to exit
+        char c = 'M';
+        while( write(fd, &c, 1) < 0 && errno == EINTR )
+            ;
+        close(fd);
+    }
+#else
+    (void)fd;
+#endif
+}
+
 /// main!
 int main(int argc, char *argv[])
 {
     init_debug_list();
     ProgramParams   params(argc, argv);
+    Parallel_SetThreadCount(params.num_threads);
+    Parallel_InitJobServer();
+
+    // Write the `--time-report` file however compilation finishes
+    ::std::string   report_crate_name = params.infile;
+    struct TimeReportWriter {
+        const ProgramParams& params;
+        const ::std::string& crate_name;
+        ~TimeReportWriter() {
+            if( params.time_report_file != "" && !TimeReport_Write(params.time_report_file, crate_name) )
+                ::std::cerr << "Unable to write time report to " << params.time_report_file << ::std::endl;
+        }
+    } time_report_writer { params, report_crate_name };
+    if( params.time_report_file != "" )
+    {
+        TimeReport_Enable();
+    }
+    if( params.debug.print_stats )
+    {
+        Macro_EnableStats();
+    }
 
     // Set up cfg values
     CompilePhaseV("Setup", [&]() {
@@ -296,6 +360,8 @@ int main(int argc, char *argv[])
         CompilePhaseV("LoadCrates", [&]() {
             // Hacky!
             AST::g_crate_overrides = params.crate_overrides;
+            // A build tool that wants the metadata signal is pipelining, so dependencies may not have their code yet
+            AST::g_allow_metadata_only_crates = (params.metadata_fd >= 0);
             for(const auto& ld : params.lib_search_dirs)
             {
                 AST::g_crate_load_dirs.push_back(ld);
@@ -370,6 +436,7 @@ int main(int argc, char *argv[])
             }
         }
         crate.m_crate_name = crate_name;
+        report_crate_name = crate_name;
         if( params.test_harness )
         {
             crate.m_crate_name += "$test";
@@ -681,6 +748,11 @@ int main(int argc, char *argv[])
                 });
         }
         memory_dump("MIR Gen");
+        // - Only the MIR is used from here on (serialisation included), so release the typed expression trees
+        CompilePhaseV("Free HIR Expressions", [&]() {
+            HIR_FreeExpressions(*hir_crate);
+            });
+        memory_dump("HIR Freed");
 
         // Validate the MIR
         CompilePhaseV("MIR Validate", [&]() {
@@ -733,6 +805,8 @@ int main(int argc, char *argv[])
         TransOptions    trans_opt;
         trans_opt.mode = params.codegen.codegen_type == "" ? "c" : params.codegen.codegen_type;
         trans_opt.build_command_file = params.codegen.emit_build_command;
+        trans_opt.codegen_units = params.codegen.codegen_units;
+        trans_opt.object_cache_dir = params.codegen.object_cache_dir;
         trans_opt.opt_level = params.opt_level;
         trans_opt.panic_crate = params.codegen.panic_type == "" ? "panic_abort" : "panic_"+params.codegen.panic_type;
         for(const char* libdir : params.lib_search_dirs ) {
@@ -784,6 +858,16 @@ int main(int argc, char *argv[])
         CompilePhaseV("MIR Optimise Inline", [&]() { MIR_OptimiseCrate_Inlining(*hir_crate, items); });
         // - Clean up no-unused functions
         CompilePhaseV("Trans Enumerate Cleanup", [&]() { Trans_Enumerate_Cleanup(*hir_crate, items); });
+        // NOTE: proc macros generate code from a second list (below), so count that one instead
+        if( crate_type != ::AST::Crate::Type::ProcMacro )
+        {
+            TimeReport_AddCount("mono_functions", items.m_functions.size());
+        }
+        // - Emit functions with the same code only once
+        if( !params.debug.disable_fold_identical )
+        {
+            CompilePhaseV("Trans Fold Identical", [&]() { Trans_FoldIdentical(*hir_crate, trans_opt, items); });
+        }
 
         memory_dump("Trans");
 
@@ -793,7 +877,8 @@ int main(int argc, char *argv[])
             throw "";
         case ::AST::Crate::Type::RustLib:
             // Save a loadable HIR dump
-            CompilePhaseV("HIR Serialise", [&]() { HIR_Serialise(params.outfile + ".hir", *hir_crate); });
+            CompilePhaseV("HIR Serialise", [&]() { HIR_Serialise(params.outfile + ".hir", *hir_crate, !params.hir_uncompressed); });
+            signal_metadata_ready(params.metadata_fd);
             // Generate a loadable .o
             CompilePhaseV("Trans Codegen", [&]() { Trans_Codegen(params.outfile, CodegenOutput::StaticLibrary, trans_opt, *hir_crate, items, params.outfile + ".hir"); });
             break;
@@ -801,9 +886,10 @@ int main(int argc, char *argv[])
             // Save a loadable HIR dump
             CompilePhaseV("HIR Serialise", [&]() {
                 //auto saved_ext_crates = ::std::move(hir_crate->m_ext_crates);
-                HIR_Serialise(params.outfile + ".hir", *hir_crate);
+                HIR_Serialise(params.outfile + ".hir", *hir_crate, !params.hir_uncompressed);
                 //hir_crate->m_ext_crates = ::std::move(saved_ext_crates);
                 });
+            signal_metadata_ready(params.metadata_fd);
             // Generate a .so
             CompilePhaseV("Trans Codegen", [&]() { Trans_Codegen(params.outfile, CodegenOutput::DynamicLibrary, trans_opt, *hir_crate, items, params.outfile + ".hir"); });
             break;
@@ -819,10 +905,11 @@ int main(int argc, char *argv[])
             CompilePhaseV("Trans Auto Impls PM", [&]() { Trans_AutoImpls(*hir_crate, items); });
             CompilePhaseV("Trans Monomorph PM", [&]() { Trans_Monomorphise_List(*hir_crate, items); });
             CompilePhaseV("MIR Optimise Inline PM", [&]() { MIR_OptimiseCrate_Inlining(*hir_crate, items); });
+            TimeReport_AddCount("mono_functions", items.m_functions.size());
             // - Save a very basic HIR dump, making sure that there's no lang items in it (e.g. `mrustc-main`)
             CompilePhaseV("HIR Serialise", [&]() {
                 auto saved_lang_items = ::std::move(hir_crate->m_lang_items); hir_crate->m_lang_items.clear();
-                HIR_Serialise(params.outfile + ".hir", *hir_crate);
+                HIR_Serialise(params.outfile + ".hir", *hir_crate, !params.hir_uncompressed);
                 hir_crate->m_lang_items = ::std::move(saved_lang_items);
                 });
             CompilePhaseV("Trans Codegen", [&]() { Trans_Codegen(params.outfile, CodegenOutput::Executable, trans_opt, *hir_crate, items, params.outfile + ".hir"); });
@@ -849,9 +936,31 @@ int main(int argc, char *argv[])
     //    return 2;
     //}
 
+    if( params.debug.print_stats )
+    {
+        Macro_PrintStats(::std::cout);
+        Typecheck_PrintStats(::std::cout);
+    }
+    if( ItemProfile_IsEnabled() )
+    {
+        ItemProfile_Print(::std::cout);
+    }
+
     return 0;
 }
 
+/// Parse a thread count (for `-j`/`$MRUSTC_THREADS`), exiting with an error if it isn't a positive integer
+static unsigned parse_thread_count(const char* source, const char* val)
+{
+    char* end;
+    long v = ::std::strtol(val, &end, 10);
+    if( *val == '\0' || *end != '\0' || v <= 0 || v > 1024 ) {
+        ::std::cerr << source << " expects a thread count between 1 and 1024, got '" << val << "'" << ::std::endl;
+        exit(1);
+    }
+    return static_cast<unsigned>(v);
+}
+
 ProgramParams::ProgramParams(int argc, char *argv[])
 {
     if( const auto* a = getenv("MRUSTC_TARGET_VER") )
@@ -868,6 +977,22 @@ ProgramParams::ProgramParams(int argc, char *argv[])
         else {
         }
     }
+    if( const auto* a = getenv("MRUSTC_THREADS") )
+    {
+        this->num_threads = parse_thread_count("$MRUSTC_THREADS", a);
+    }
+    if( const auto* a = getenv("MRUSTC_OBJECT_CACHE") )
+    {
+        this->codegen.object_cache_dir = a;
+    }
+    if( const auto* a = getenv("MRUSTC_HIR_UNCOMPRESSED") )
+    {
+        this->hir_uncompressed = (strcmp(a, "1") == 0);
+    }
+    if( const auto* a = getenv("MRUSTC_METADATA_FD") )
+    {
+        this->metadata_fd = ::std::strtol(a, nullptr, 10);
+    }
 
     // Hacky command-line parsing
     for( int i = 1; i < argc; i ++ )
@@ -938,6 +1063,20 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                     this->libraries.push_back( arg+1 );
                 }
                 continue ;
+            case 'j': {
+                const char* val;
+                if( arg[1] == '\0' ) {
+                    if( i == argc - 1 ) {
+                        ::std::cerr << "Option " << arg << " requires an argument" << ::std::endl;
+                        exit(1);
+                    }
+                    val = argv[++i];
+                }
+                else {
+                    val = arg+1;
+                }
+                this->num_threads = parse_thread_count("Option -j", val);
+                } continue ;
             case 'C': {
                 ::std::string optname;
                 ::std::string optval;
@@ -985,6 +1124,19 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                     get_optval();
                     this->codegen.panic_type = optval;
                 }
+                else if( optname == "codegen-units" ) {
+                    get_optval();
+                    char* end;
+                    this->codegen.codegen_units = ::std::strtol(optval.c_str(), &end, 10);
+                    if( *end != '\0' || this->codegen.codegen_units == 0 ) {
+                        ::std::cerr << "Codegen option codegen-units expects a positive integer, got '" << optval << "'" << ::std::endl;
+                        exit(1);
+                    }
+                }
+                else if( optname == "object-cache" ) {
+                    get_optval();
+                    this->codegen.object_cache_dir = optval;
+                }
                 else {
                     ::std::cerr << "Unknown codegen option: '" << optname << "'" << ::std::endl;
                     exit(1);
@@ -1025,6 +1177,10 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                     no_optval();
                     this->debug.disable_mir_optimisations = true;
                 }
+                else if( optname == "disable-fold-identical" ) {
+                    no_optval();
+                    this->debug.disable_fold_identical = true;
+                }
                 else if( optname == "full-validate" ) {
                     no_optval();
                     this->debug.full_validate = true;
@@ -1033,6 +1189,10 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                     no_optval();
                     this->debug.full_validate_early = true;
                 }
+                else if( optname == "hir-uncompressed" ) {
+                    no_optval();
+                    this->hir_uncompressed = true;
+                }
                 else if( optname == "dump-ast" ) {
                     no_optval();
                     this->debug.dump_ast = true;
@@ -1062,6 +1222,23 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                         exit(1);
                     }
                 }
+                else if( optname == "print-stats" ) {
+                    no_optval();
+                    this->debug.print_stats = true;
+                }
+                else if( optname == "profile-items" ) {
+                    unsigned top_n = 20;
+                    if( eq_pos != ::std::string::npos ) {
+                        char* end;
+                        long v = ::std::strtol(optval.c_str(), &end, 10);
+                        if( optval.empty() || *end != '\0' || v <= 0 ) {
+                            ::std::cerr << "Debug option profile-items expects a positive integer, got '" << optval << "'" << ::std::endl;
+                            exit(1);
+                        }
+                        top_n = static_cast<unsigned>(v);
+                    }
+                    ItemProfile_Enable(top_n);
+                }
                 else if( optname == "print-cfgs") {
                     no_optval();
                     this->print_cfgs = true;
@@ -1245,6 +1422,17 @@ ProgramParams::ProgramParams(int argc, char *argv[])
             else if( strcmp(arg, "--test") == 0 ) {
                 this->test_harness = true;
             }
+            // `--time-report=<file>` - Write a JSON profile of the compilation
+            else if( strncmp(arg, "--time-report=", 14) == 0 ) {
+                this->time_report_file = arg + 14;
+            }
+            else if( strcmp(arg, "--time-report") == 0 ) {
+                if (i == argc - 1) {
+                    ::std::cerr << "Flag " << arg << " requires an argument" << ::std::endl;
+                    exit(1);
+                }
+                this->time_report_file = argv[++i];
+            }
             else if( strcmp(arg, "--edition") == 0 ) {
                 if (i == argc - 1) {
                     ::std::cerr << "Flag " << arg << " requires an argument" << ::std::endl;
@@ -1317,6 +1505,7 @@ void ProgramParams::show_help() const
         "-o <filename>      : Write compiler output (library or executable) to this file\n"
         "-O                 : Enable optimisation\n"
         "-g                 : Emit debugging information\n"
+        "-j <n>             : Use <n> threads for parallel compilation phases (default from $MRUSTC_THREADS, or 1)\n"
         "--out-dir <dir>    : Specify the output directory (alternative to `-o`)\n"
         "--extern <crate>=<path>\n"
         "                   : Specify the path for a given crate (instead of searching for it)\n"
@@ -1327,6 +1516,8 @@ void ProgramParams::show_help() const
         "--cfg flag=\"val\"   : Set a string #[cfg]/cfg! flag\n"
         "--target <name>    : Compile code for the given target\n"
         "--test             : Generate a unit test executable\n"
+        "--time-report=<file>\n"
+        "                   : Write per-phase time/memory usage and item counts to <file> as JSON\n"
         "-C <option>        : Code-generation options\n"
         "-Z <option>        : Debugging/experimental options\n"
         ;
@@ -20,6 +20,10 @@
 #include <hir/expr_state.hpp>
 #include <trans/target.hpp> // Target_GetSizeAndAlignOf - for `box`
 #include <cctype>   // isdigit
+#include <time_report.hpp>
+#ifdef __GLIBC__
+# include <malloc.h>    // malloc_trim
+#endif
 
 namespace {
 
@@ -2642,14 +2646,63 @@ void HIR_GenerateMIR(::HIR::Crate& crate)
             }
         } };
     ov.visit_crate(crate);
+}
+
+namespace {
+    class ExprFreeVisitor:
+        public ::MIR::OuterVisitor
+    {
+        // Body of the function being visited (anything else visited within it, e.g. array sizes, is a constant)
+        const ::HIR::ExprPtr*   m_fcn_body = nullptr;
+    public:
+        size_t  m_num_freed = 0;
+
+        ExprFreeVisitor(const ::HIR::Crate& crate):
+            ::MIR::OuterVisitor(crate, [this](const auto& res, const auto& p, ::HIR::ExprPtr& expr_ptr, const auto& args, const auto& ty){
+                this->free_expr(expr_ptr);
+            })
+        {
+        }
+
+        void visit_function(::HIR::ItemPath p, ::HIR::Function& item) override
+        {
+            auto* saved_body = m_fcn_body;
+            m_fcn_body = &item.m_code;
+            ::MIR::OuterVisitor::visit_function(p, item);
+            m_fcn_body = saved_body;
+        }
 
-    // Once MIR is generated, free the HIR expression tree (replace each node with an empty tuple node)
-    ::MIR::OuterVisitor ov_free(crate, [&](const auto& res, const auto& p, ::HIR::ExprPtr& expr_ptr, const auto& args, const auto& ty){
-        if( expr_ptr )
+    private:
+        void free_expr(::HIR::ExprPtr& expr_ptr)
         {
+            if( !expr_ptr )
+                return ;
+            ASSERT_BUG(expr_ptr.span(), expr_ptr.m_mir, "Freeing HIR for an expression without MIR");
+            // Replace the tree with an empty tuple node (keeping the span, and the "has local code" state used by
+            // `get_ext_mir`)
             expr_ptr.reset(new ::HIR::ExprNode_Tuple(expr_ptr->m_span, {}));
+            // Variable types are copied into the MIR locals
+            expr_ptr.m_bindings = ::std::vector<::HIR::TypeRef>();
+            // Constants (and array sizes/enum values) keep their state for deferred consteval of generic values
+            if( &expr_ptr == m_fcn_body )
+            {
+                expr_ptr.m_state = ::HIR::ExprStatePtr();
+            }
+            m_num_freed ++;
         }
-        });
-    ov_free.visit_crate(crate);
+    };
+}
+
+void HIR_FreeExpressions(::HIR::Crate& crate)
+{
+    ExprFreeVisitor ov { crate };
+    ov.visit_crate(crate);
+    DEBUG("Freed " << ov.m_num_freed << " expression trees");
+    TimeReport_AddCount("hir_exprs_freed", ov.m_num_freed);
+
+#ifdef __GLIBC__
+    // The trees are made up of many small allocations, which glibc keeps in the heap instead of handing back
+    malloc_trim(0);
+#endif
 }
 
@@ -1187,7 +1187,7 @@ void MIR_Helper_GetLifetimes_DetermineValueLifetime(
             return this->end == Position { ~0u, ~0u };
         }
     };
-    static unsigned NEXT_INDEX = 0;
+    static thread_local unsigned NEXT_INDEX = 0;
     struct State
     {
         unsigned int index = 0;
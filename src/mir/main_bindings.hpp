@@ -12,6 +12,8 @@
 class TransList;
 
 extern void HIR_GenerateMIR(::HIR::Crate& crate);
+/// Release the HIR expression trees (only the MIR is used after lowering)
+extern void HIR_FreeExpressions(::HIR::Crate& crate);
 extern void MIR_Dump(::std::ostream& sink, const ::HIR::Crate& crate);
 extern void MIR_CheckCrate(/*const*/ ::HIR::Crate& crate);
 extern void MIR_CheckCrate_Full(/*const*/ ::HIR::Crate& crate);
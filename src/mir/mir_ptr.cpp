@@ -7,13 +7,32 @@
  */
 #include "mir_ptr.hpp"
 #include "mir.hpp"
+#include <mutex>
 
+namespace {
+    // Serialises lazy loads, so two threads asking for the same extern function only decode it once
+    ::std::mutex    s_lazy_load_lock;
+}
 
 void ::MIR::FunctionPointer::reset()
 {
-    if( this->ptr ) {
-        delete this->ptr;
-        this->ptr = nullptr;
+    auto* p = this->ptr.exchange(nullptr);
+    if( p ) {
+        delete p;
     }
+    m_lazy_source.reset();
 }
 
+::MIR::Function* ::MIR::FunctionPointer::load_lazy() const
+{
+    ::std::lock_guard<::std::mutex>   lh { s_lazy_load_lock };
+    // Another thread may have loaded it while this one waited
+    if( auto* p = ptr.load() )
+        return p;
+    if( !m_lazy_source )
+        return nullptr;
+    auto* p = m_lazy_source->load(m_lazy_idx);
+    ptr.store(p, ::std::memory_order_release);
+    // NOTE: The source is kept, as `operator bool` may be called concurrently
+    return p;
+}
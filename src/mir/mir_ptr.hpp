@@ -6,6 +6,9 @@
  * - Pointer to a blob of MIR
  */
 #pragma once
+#include <memory>
+#include <atomic>
+#include <cstddef>
 
 namespace MIR {
 
@@ -13,30 +16,72 @@ class Function;
 
 class FunctionPointer
 {
-    ::MIR::Function*    ptr;
 public:
-    FunctionPointer(): ptr(nullptr) {}
-    FunctionPointer(::MIR::Function* p): ptr(p) {}
-    FunctionPointer(FunctionPointer&& x): ptr(x.ptr) { x.ptr = nullptr; }
+    /// Source of MIR that is only decoded when first used (e.g. function bodies in extern crate metadata)
+    class LazySource
+    {
+    public:
+        virtual ~LazySource() {}
+        /// Decode body `idx`, returning a newly allocated function
+        virtual ::MIR::Function* load(size_t idx) const = 0;
+    };
+private:
+    mutable ::std::atomic<::MIR::Function*> ptr;
+    // If set, `ptr` is populated from this on first access
+    ::std::shared_ptr<const LazySource>  m_lazy_source;
+    size_t  m_lazy_idx;
+public:
+    FunctionPointer(): ptr(nullptr), m_lazy_idx(0) {}
+    FunctionPointer(::MIR::Function* p): ptr(p), m_lazy_idx(0) {}
+    FunctionPointer(FunctionPointer&& x):
+        ptr(x.ptr.load()),
+        m_lazy_source(::std::move(x.m_lazy_source)),
+        m_lazy_idx(x.m_lazy_idx)
+    {
+        x.ptr = nullptr;
+    }
+
+    /// Create a pointer that decodes body `idx` from `source` when first dereferenced
+    static FunctionPointer lazy(::std::shared_ptr<const LazySource> source, size_t idx) {
+        FunctionPointer rv;
+        rv.m_lazy_source = ::std::move(source);
+        rv.m_lazy_idx = idx;
+        return rv;
+    }
 
     ~FunctionPointer() {
         reset();
     }
     FunctionPointer& operator=(FunctionPointer&& x) {
         reset();
-        ptr = x.ptr;
+        ptr = x.ptr.load();
+        m_lazy_source = ::std::move(x.m_lazy_source);
+        m_lazy_idx = x.m_lazy_idx;
         x.ptr = nullptr;
         return *this;
     }
 
     void reset();
 
-          ::MIR::Function* operator->()       { if(!ptr) throw ""; return ptr; }
-    const ::MIR::Function* operator->() const { if(!ptr) throw ""; return ptr; }
-          ::MIR::Function& operator*()       { if(!ptr) throw ""; return *ptr; }
-    const ::MIR::Function& operator*() const { if(!ptr) throw ""; return *ptr; }
+          ::MIR::Function* operator->()       { return &get(); }
+    const ::MIR::Function* operator->() const { return &get(); }
+          ::MIR::Function& operator*()       { return get(); }
+    const ::MIR::Function& operator*() const { return get(); }
 
-    operator bool() const { return ptr != nullptr; }
+    /// Check if there is MIR (doesn't trigger a lazy load)
+    operator bool() const { return ptr != nullptr || m_lazy_source; }
+    /// Check if the MIR has been decoded yet
+    bool is_loaded() const { return ptr != nullptr; }
+private:
+    ::MIR::Function& get() const {
+        auto* p = ptr.load(::std::memory_order_acquire);
+        if( !p ) {
+            p = load_lazy();
+            if(!p) throw "";
+        }
+        return *p;
+    }
+    ::MIR::Function* load_lazy() const;
 };
 
 }
@@ -16,8 +16,11 @@
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
+#include <chrono>
 #include <trans/target.hpp>
 #include <trans/trans_list.hpp> // Note: This is included for inlining after enumeration and monomorph
+#include <parallel.hpp>
+#include <time_report.hpp>
 
 #include <hir/expr.hpp> // HACK
 
@@ -59,8 +62,9 @@ enum {
     CHECKMODE_ALL,
 };
 static int check_mode() {
-    static int mode = CHECKMODE_UNKNOWN;
-    if( mode == CHECKMODE_UNKNOWN ) {
+    // Initialised once (thread-safely) on first call, as optimisation can run on worker threads
+    static const int mode = []() {
+        int mode = CHECKMODE_UNKNOWN;
         const auto* n = getenv("MRUSTC_MIR_CHECK");
         if(n)
         {
@@ -87,7 +91,8 @@ static int check_mode() {
         if( mode == CHECKMODE_UNKNOWN ) {
             mode = CHECKMODE_FINAL;
         }
-    }
+        return mode;
+    }();
     return mode;
 }
 static bool check_after_all() {
@@ -164,6 +169,7 @@ void MIR_Optimise(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path
     static Span sp;
     TRACE_FUNCTION_F(path);
     ::MIR::TypeResolve   state { sp, resolve, FMT_CB(ss, ss << path;), ret_type, args, fcn };
+    auto profile_start = ::std::chrono::steady_clock::now();
 
     bool change_happened;
     unsigned int pass_num = 0;
@@ -428,6 +434,16 @@ void MIR_Optimise(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path
     {
         MIR_Validate(resolve, path, fcn, args, ret_type);
     }
+
+    if( ItemProfile_IsEnabled() )
+    {
+        // NOTE: A function can be optimised both without and with inlining (see `MIR_OptimiseCrate`), so
+        // record the two as separate phases.
+        ItemProfile_Record(do_inline ? "MIR Optimise" : "MIR Optimise (no inline)", FMT(path), ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - profile_start).count(), {
+            { "passes", pass_num },
+            { "blocks", fcn.blocks.size() },
+            });
+    }
 }
 
 namespace
@@ -5846,18 +5862,74 @@ void MIR_SortBlocks(const StaticTraitResolve& resolve, const ::HIR::ItemPath& pa
 
 void MIR_OptimiseCrate(::HIR::Crate& crate, bool do_minimal_optimisation)
 {
-    ::MIR::OuterVisitor ov { crate, [do_minimal_optimisation](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
-        {
-            //if( ! dynamic_cast<::HIR::ExprNode_Block*>(expr.get()) ) {
-            //    return ;
-            //}
-            auto& mir = expr.get_mir_or_error_mut(Span());
-            if( do_minimal_optimisation ) {
+    if( do_minimal_optimisation )
+    {
+        ::MIR::OuterVisitor ov { crate, [](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
+            {
+                auto& mir = expr.get_mir_or_error_mut(Span());
                 MIR_OptimiseMin(res, p, mir, args, ty);
+                TimeReport_AddCount("mir_functions", 1);
+                TimeReport_AddCount("mir_basic_blocks", mir.blocks.size());
             }
-            else {
+            };
+        ov.visit_crate(crate);
+        return ;
+    }
+
+    // First do the per-function optimisations (i.e. everything except inlining, which reads the MIR of other
+    // functions) in parallel, then inline serially.
+    // - This is the same sequence no matter how many threads are in use, so the output doesn't depend on it.
+    struct WorkItem {
+        ::std::string   path;
+        const ::HIR::GenericParams* impl_generics;
+        const ::HIR::GenericParams* item_generics;
+        ::HIR::ExprPtr* expr;
+        const ::HIR::Function::args_t*  args;
+        ::HIR::TypeRef  ret_ty;
+    };
+    static const ::HIR::Function::args_t    empty_args;
+    ::std::vector<WorkItem> items;
+    ::MIR::OuterVisitor ov_collect { crate, [&](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
+        {
+            // NOTE: `args` can be a temporary if empty, `ty` can also be a temporary (so is cloned)
+            items.push_back(WorkItem { FMT(p), res.m_impl_generics, res.m_item_generics, &expr, args.empty() ? &empty_args : &args, ty.clone() });
+        }
+        };
+    ov_collect.visit_crate(crate);
+
+    // One resolver per worker, as the resolver's caches aren't shareable between threads (and depend on the current generics)
+    ::std::vector<::std::unique_ptr<StaticTraitResolve>>    resolvers;
+    for(unsigned i = 0; i < Parallel_GetThreadCount(); i ++)
+        resolvers.push_back(::std::make_unique<StaticTraitResolve>(crate));
+
+    Parallel_ForEach(items.size(), [&](unsigned worker, size_t idx) {
+        const auto& item = items[idx];
+        auto& res = *resolvers[worker];
+        if(item.impl_generics)  res.set_impl_generics_raw(*item.impl_generics);
+        if(item.item_generics)  res.set_item_generics_raw(*item.item_generics);
+        ::HIR::ItemPath ip(item.path);
+        auto& mir = item.expr->get_mir_or_error_mut(Span());
+        MIR_Optimise(res, ip, mir, *item.args, item.ret_ty, /*do_inline=*/false);
+        if(item.impl_generics)  res.clear_impl_generics();
+        if(item.item_generics)  res.clear_item_generics();
+        });
+
+    ::MIR::OuterVisitor ov { crate, [](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
+        {
+            static Span sp;
+            auto& mir = expr.get_mir_or_error_mut(Span());
+            // The function is already optimised, so only re-run the optimiser if inlining changed something
+            ::MIR::TypeResolve   state { sp, res, FMT_CB(ss, ss << p;), ty, args, mir };
+            if( MIR_Optimise_Inlining(state, mir, /*minimal=*/false) )
+            {
+                MIR_Cleanup(res, p, mir, args, ty);
+                if( check_after_all() ) {
+                    MIR_Validate(res, p, mir, args, ty);
+                }
                 MIR_Optimise(res, p, mir, args, ty);
             }
+            TimeReport_AddCount("mir_functions", 1);
+            TimeReport_AddCount("mir_basic_blocks", mir.blocks.size());
         }
         };
     ov.visit_crate(crate);
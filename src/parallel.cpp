@@ -0,0 +1,129 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * parallel.cpp
+ * - Simple worker pool for running independent per-item work across threads
+ */
+#if defined(__MINGW32__)
+# define DISABLE_MULTITHREAD    // Mingw32 doesn't have c++11 threads
+#endif
+
+#include <parallel.hpp>
+#include <jobserver.h>  // tools/common/jobserver.h
+#include <vector>
+#include <algorithm>   // min
+#include <cstdint>   // SIZE_MAX
+#include <exception>
+#ifndef DISABLE_MULTITHREAD
+# include <thread>
+# include <mutex>
+# include <atomic>
+#endif
+
+namespace {
+    unsigned s_thread_count = 1;
+    ::std::unique_ptr<::helpers::JobServer> s_jobserver;
+
+    void for_each_inner(unsigned thread_count, size_t count, const ::std::function<void(unsigned worker, size_t idx)>& cb);
+}
+
+void Parallel_SetThreadCount(unsigned count)
+{
+    s_thread_count = (count == 0 ? 1 : count);
+}
+unsigned Parallel_GetThreadCount()
+{
+    return s_thread_count;
+}
+
+void Parallel_ForEach(size_t count, ::std::function<void(unsigned worker, size_t idx)> cb)
+{
+    for_each_inner(s_thread_count, count, cb);
+}
+
+void Parallel_InitJobServer()
+{
+    s_jobserver = ::helpers::JobServer::from_environment();
+    if( !s_jobserver && s_thread_count > 1 )
+    {
+        s_jobserver = ::helpers::JobServer::create(s_thread_count);
+    }
+}
+void Parallel_ForEachJob(size_t count, ::std::function<void(unsigned worker, size_t idx)> cb)
+{
+    if( !s_jobserver )
+    {
+        for_each_inner(s_thread_count, count, cb);
+        return ;
+    }
+    // The jobserver limits how many run at once, so use enough workers to take every slot it could hand out
+    unsigned thread_count = ::std::max(s_thread_count, s_jobserver->max_jobs());
+    auto* js = s_jobserver.get();
+    for_each_inner(thread_count, count, [&](unsigned worker, size_t idx) {
+        ::helpers::JobServer::Slot  slot { js };
+        cb(worker, idx);
+        });
+}
+
+namespace {
+void for_each_inner(unsigned thread_count, size_t count, const ::std::function<void(unsigned worker, size_t idx)>& cb)
+{
+#ifndef DISABLE_MULTITHREAD
+    if( thread_count > 1 && count > 1 )
+    {
+        ::std::atomic<size_t>   next_idx { 0 };
+        ::std::atomic<bool> failed { false };
+        ::std::mutex    error_mutex;
+        size_t  error_idx = SIZE_MAX;
+        ::std::exception_ptr    error;
+
+        auto thread_body = [&](unsigned worker) {
+            while( !failed )
+            {
+                size_t idx = next_idx ++;
+                if( idx >= count )
+                    break;
+                try
+                {
+                    cb(worker, idx);
+                }
+                catch(...)
+                {
+                    ::std::lock_guard<::std::mutex> lh { error_mutex };
+                    if( idx < error_idx ) {
+                        error_idx = idx;
+                        error = ::std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+            };
+
+        size_t num_threads = ::std::min<size_t>(thread_count, count);
+        ::std::vector<::std::thread>    threads;
+        threads.reserve(num_threads - 1);
+        for(size_t i = 1; i < num_threads; i ++)
+        {
+            threads.push_back(::std::thread(thread_body, static_cast<unsigned>(i)));
+        }
+        // The calling thread takes part too
+        thread_body(0);
+        for(auto& t : threads)
+        {
+            t.join();
+        }
+
+        if( error )
+        {
+            ::std::rethrow_exception(error);
+        }
+        return ;
+    }
+#endif
+    for(size_t idx = 0; idx < count; idx ++)
+    {
+        cb(0, idx);
+    }
+}
+}   // namespace
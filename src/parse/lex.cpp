@@ -15,6 +15,7 @@
 #include <typeinfo>
 #include <algorithm>    // std::count
 #include <cctype>
+#include <fstream>
 //#define TRACE_CHARS
 //#define TRACE_RAW_TOKENS
 
@@ -23,16 +24,30 @@ Lexer::Lexer(const ::std::string& filename, ParseState ps):
     m_path(filename.c_str()),
     m_line(1),
     m_line_ofs(0),
-    m_istream(filename.c_str()),
+    m_pos(0),
     m_last_char_valid(false),
     m_hygiene( Ident::Hygiene::new_scope() )
 {
-    if( !m_istream.is_open() )
+    // Read the whole file in one go, the lexer then works directly on the buffer
+    ::std::ifstream is(filename.c_str(), ::std::ios::binary);
+    if( !is.is_open() )
     {
         throw ::std::runtime_error("Unable to open file '" + filename + "'");
     }
+    is.seekg(0, ::std::ios::end);
+    auto len = is.tellg();
+    is.seekg(0, ::std::ios::beg);
+    if( len > 0 )
+    {
+        m_data.resize(static_cast<size_t>(len));
+        if( !is.read(m_data.data(), m_data.size()) )
+        {
+            throw ::std::runtime_error("Unable to read file '" + filename + "'");
+        }
+    }
+
     // Consume the BOM
-    if( this->getc_byte() == '\xef' )
+    if( !m_data.empty() && this->getc_byte() == '\xef' )
     {
         if( this->getc_byte() != '\xbb' ) {
             throw ::std::runtime_error("Incomplete BOM - missing \\xBB in second position");
@@ -44,10 +59,44 @@ Lexer::Lexer(const ::std::string& filename, ParseState ps):
     }
     else
     {
-        m_istream.unget();
+        m_pos = 0;
+        m_line = 1;
     }
 }
 
+namespace {
+    inline bool is_ascii_ident(char c) {
+        return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_';
+    }
+    inline bool is_ascii_hspace(char c) {
+        return c == ' ' || c == '\t' || c == '\x0C';
+    }
+    inline bool is_ascii_nonnewline(char c) {
+        return c != '\n' && c != '\r' && static_cast<unsigned char>(c) < 0x80;
+    }
+}
+
+template<typename Pred>
+size_t Lexer::ascii_run(Pred pred) const
+{
+    // Can't skip ahead if there's a pushed-back character
+    if( m_last_char_valid )
+        return 0;
+    const char* const start = m_data.data() + m_pos;
+    const char* const end = m_data.data() + m_data.size();
+    const char* p = start;
+    while( p != end && pred(*p) )
+        p ++;
+    return p - start;
+}
+void Lexer::consume_ascii_run(size_t n, ::std::string* out)
+{
+    if( out )
+        out->append(m_data.data() + m_pos, n);
+    m_pos += n;
+    m_line_ofs += n;
+}
+
 
 #define LINECOMMENT -1
 #define BLOCKCOMMENT -2
@@ -367,6 +416,7 @@ Token Lexer::getTokenInt()
             return Token(TOK_NEWLINE);
         if( ch.isspace() )
         {
+            this->consume_ascii_run(this->ascii_run(is_ascii_hspace), nullptr);
             while( (ch = this->getc()).isspace() && ch != '\n' )
                 ;
             this->ungetc();
@@ -650,6 +700,7 @@ Token Lexer::getTokenInt()
                 while(ch != '\n' && ch != '\r')
                 {
                     str += ch;
+                    this->consume_ascii_run(this->ascii_run(is_ascii_nonnewline), &str);
                     ch = this->getc();
                 }
                 this->ungetc();
@@ -712,6 +763,7 @@ Token Lexer::getTokenInt()
                         }
                         else {
                             str += ch;
+                            this->consume_ascii_run(this->ascii_run([](char c){ return c != '/' && c != '*' && is_ascii_nonnewline(c); }), &str);
                         }
                     }
                     ch = this->getc();
@@ -878,6 +930,7 @@ Token Lexer::getTokenInt_Identifier(Codepoint leader, Codepoint leader2, bool pa
     while( issym(ch) )
     {
         str += ch;
+        this->consume_ascii_run(this->ascii_run(is_ascii_ident), &str);
         ch = this->getc();
     }
 
@@ -1006,18 +1059,15 @@ uint32_t Lexer::parseEscape(char enclosing)
 
 char Lexer::getc_byte()
 {
-    int rv = m_istream.get();
-    if( rv == EOF || m_istream.eof() )
+    if( m_pos == m_data.size() )
         throw Lexer::EndOfFile();
+    char rv = m_data[m_pos++];
 
     if( rv == '\r' )
     {
-        if( m_istream.get() != '\n' )
-        {
-            m_istream.unget();
-        }
-        else
+        if( m_pos != m_data.size() && m_data[m_pos] == '\n' )
         {
+            m_pos ++;
             rv = '\n';
         }
     }
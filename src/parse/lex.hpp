@@ -9,7 +9,7 @@
 #define LEX_HPP_INCLUDED
 
 #include <string>
-#include <fstream>
+#include <vector>
 #include "tokenstream.hpp"
 
 struct Codepoint {
@@ -39,7 +39,10 @@ class Lexer:
     unsigned int m_line;
     unsigned int m_line_ofs;
 
-    ::std::ifstream m_istream;
+    /// Entire source file, scanned in-place
+    ::std::vector<char> m_data;
+    /// Offset of the next byte in `m_data`
+    size_t  m_pos;
     bool    m_last_char_valid;
     Codepoint   m_last_char;
     ::std::vector<Token>    m_next_tokens;
@@ -76,6 +79,13 @@ private:
     Codepoint getc_cp();
     char getc_byte();
 
+    /// Fast path for runs of plain ASCII: returns the number of bytes at the current position that match `pred`
+    /// - `pred` must reject '\r', '\n' and non-ASCII bytes (so only the column changes)
+    template<typename Pred>
+    size_t ascii_run(Pred pred) const;
+    /// Consume `n` bytes found by `ascii_run`, appending them to `out` (if non-null)
+    void consume_ascii_run(size_t n, ::std::string* out);
+
     class EndOfFile {};
 };
 
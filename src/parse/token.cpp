@@ -317,6 +317,25 @@ struct EscapedString {
     }
 };
 
+size_t Token::hash() const
+{
+    size_t  h = static_cast<size_t>(m_type);
+    TU_MATCH_HDRA( (m_data), {)
+    TU_ARMA(None, e) {}
+    TU_ARMA(Ident,   e) { h = h * 31 + ::std::hash<RcString>()(e.name); }
+    TU_ARMA(String,  e) { h = h * 31 + ::std::hash<::std::string>()(e); }
+    TU_ARMA(Integer, e) { h = h * 31 + static_cast<size_t>(e.m_intval); }
+    TU_ARMA(Float,   e) {
+        double  v = (e.m_floatval == 0 ? 0.0 : e.m_floatval);   // -0.0 == 0.0
+        uint64_t    bits;
+        memcpy(&bits, &v, sizeof(bits));
+        h = h * 31 + static_cast<size_t>(bits);
+        }
+    TU_ARMA(Fragment, e) {}
+    }
+    return h;
+}
+
 ::std::string Token::to_str() const
 {
     ::std::stringstream ss;
@@ -160,6 +160,8 @@ public:
         throw "";
     }
     bool operator!=(const Token& r) const { return !(*this == r); }
+    /// Hash of the type and value (consistent with `operator==`, interpolated fragments only hash the type)
+    size_t hash() const;
 
     ::std::string to_str() const;
 
@@ -10,19 +10,31 @@
 #include <string>
 #include <iostream>
 #include <algorithm>    // std::max
+#include <unordered_set>
+#include <new>  // placement new
+#include <cstddef>  // offsetof
+#include <mutex>
 
 RcString::RcString(const char* s, size_t len):
     m_ptr(nullptr)
 {
     if( len > 0 )
     {
-        m_ptr = new unsigned int[2 + (len+1 + sizeof(unsigned int)-1) / sizeof(unsigned int)];
-        m_ptr[0] = 1;
-        m_ptr[1] = static_cast<unsigned>(len);
-        char* data_mut = reinterpret_cast<char*>(m_ptr + 2);
+        void* buf = ::operator new(offsetof(Inner, data) + len + 1);
+        m_ptr = new(buf) Inner;
+        m_ptr->refcount = 1;
+        m_ptr->size = static_cast<unsigned>(len);
+        m_ptr->interned = false;
+        // http://www.cse.yorku.ca/~oz/hash.html "djb2"
+        size_t  h = 5381;
+        char* data_mut = m_ptr->data;
         for(unsigned int j = 0; j < len; j ++ )
+        {
             data_mut[j] = s[j];
+            h = h * 33 + (unsigned)s[j];
+        }
         data_mut[len] = '\0';
+        m_ptr->hash = h;
 
         //::std::cout << "RcString(" << m_ptr << " \"" << *this << "\") - " << *m_ptr << " (creation)" << ::std::endl;
     }
@@ -31,11 +43,11 @@ RcString::~RcString()
 {
     if(m_ptr)
     {
-        *m_ptr -= 1;
-        //::std::cout << "RcString(" << m_ptr << " \"" << *this << "\") - " << *m_ptr << " refs left (drop)" << ::std::endl;
-        if( *m_ptr == 0 )
+        //::std::cout << "RcString(" << m_ptr << " \"" << *this << "\") - " << m_ptr->refcount << " refs left (drop)" << ::std::endl;
+        if( --m_ptr->refcount == 0 )
         {
-            delete[] m_ptr;
+            m_ptr->~Inner();
+            ::operator delete(m_ptr);
             m_ptr = nullptr;
         }
     }
@@ -81,46 +93,42 @@ Ordering RcString::ord(const char* s) const
 }
 
 
-::std::set<RcString>    RcString_interned_strings;
+namespace {
+    struct InternTable {
+        ::std::unordered_set<RcString>  strings;
+        ::std::mutex    lock;
+    };
+    InternTable& get_intern_table() {
+        // NOTE: Leaked, so interned strings can still be compared during static destruction
+        static InternTable* s_table = new InternTable;
+        return *s_table;
+    }
+}
 
+RcString RcString::intern(RcString s)
+{
+    if( !s.m_ptr )
+        return s;
+    auto& table = get_intern_table();
+    ::std::lock_guard<::std::mutex> lh { table.lock };
+    auto it = table.strings.find(s);
+    if( it != table.strings.end() )
+        return *it;
+    // Only the cached instance gets the flag (this is the first copy of it)
+    s.m_ptr->interned = true;
+    return *table.strings.insert(::std::move(s)).first;
+}
 RcString RcString::new_interned(const ::std::string& s)
 {
-#if 0
-    auto it = RcString_interned_strings.find(s);
-    if( it == RcString_interned_strings.end() )
-    {
-        it = RcString_interned_strings.insert(RcString(s)).first;
-    }
-    return *it;
-#else
-    // TODO: interning flag, so comparisons can just be a pointer comparison
-    // - Only want to set this flag on the cached instance
-    return *RcString_interned_strings.insert(RcString(s)).first;
-#endif
+    return intern(RcString(s));
 }
 RcString RcString::new_interned(const char* s)
 {
-#if 0
-    auto it = RcString_interned_strings.find(s);
-    if( it == RcString_interned_strings.end() )
-    {
-        it = RcString_interned_strings.insert(RcString(s)).first;
-    }
-    return *it;
-#else
-    // TODO: interning flag, so comparisons can just be a pointer comparison
-    // - Only want to set this flag on the cached instance
-    return *RcString_interned_strings.insert(RcString(s)).first;
-#endif
+    return intern(RcString(s));
 }
 
 size_t std::hash<RcString>::operator()(const RcString& s) const noexcept
 {
-    // http://www.cse.yorku.ca/~oz/hash.html "djb2"
-    size_t h = 5381;
-    for(auto c : s) {
-        h = h * 33 + (unsigned)c;
-    }
-    return h;
-    //return hash<std::string_view>(s.c_str(), s.size());
+    // NOTE: Matches the hash of an empty string
+    return s.m_ptr ? s.m_ptr->hash : 5381;
 }
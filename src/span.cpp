@@ -29,8 +29,7 @@ Span::~Span()
 {
     if(m_ptr && m_ptr != &s_empty_span)
     {
-        m_ptr->reference_count --;
-        if( m_ptr->reference_count == 0 )
+        if( --m_ptr->reference_count == 0 )
         {
             delete m_ptr;
         }
@@ -0,0 +1,331 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * time_report.cpp
+ * - Compile-time profiling (`--time-report` and `-Z profile-items`)
+ */
+#include <time_report.hpp>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#ifdef _WIN32
+# define NOGDI  // Don't include GDI functions (defines some macros that collide with mrustc ones)
+# include <Windows.h>
+# include <psapi.h>
+# ifdef _MSC_VER
+#  pragma comment(lib, "psapi.lib")
+# endif
+#else
+# include <sys/resource.h>
+# include <unistd.h>
+# include <cstdio>
+#endif
+
+namespace {
+    typedef ::std::chrono::steady_clock clock_t_;
+
+    struct MemInfo {
+        // Zero if not available on this platform
+        uint64_t    rss;
+        uint64_t    peak_rss;
+    };
+    struct PhaseEnt {
+        ::std::string   name;
+        unsigned    depth;
+        clock_t_::time_point    wall_start;
+        double  cpu_start;
+        double  child_cpu_start;
+        // Populated when the phase ends
+        double  wall_s;
+        double  cpu_s;
+        double  child_cpu_s;
+        MemInfo mem;
+    };
+    struct CheckpointEnt {
+        ::std::string   name;
+        double  wall_s;
+        MemInfo mem;
+    };
+
+    bool    s_enabled = false;
+    clock_t_::time_point    s_start_time;
+    ::std::vector<PhaseEnt> s_phases;
+    ::std::vector<size_t>   s_phase_stack;
+    ::std::vector<CheckpointEnt>    s_checkpoints;
+    ::std::mutex    s_counts_lock;
+    ::std::map<::std::string, uint64_t> s_counts;
+
+    struct ItemProfileEnt {
+        double  seconds = 0;
+        unsigned    runs = 0;
+        ::std::vector<::std::pair<const char*, uint64_t>>   counters;
+    };
+    bool    s_item_profile_enabled = false;
+    unsigned    s_item_profile_top_n;
+    ::std::mutex    s_item_profile_lock;
+    // Category => Item => stats
+    ::std::map<::std::string, ::std::map<::std::string, ItemProfileEnt>>    s_item_profile;
+
+    /// Process CPU time (all threads) in seconds
+    double get_cpu_time()
+    {
+#ifdef _WIN32
+        FILETIME    creation, exit, kernel, user;
+        if( !GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user) )
+            return 0;
+        auto to_u64 = [](const FILETIME& ft){ return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+        return static_cast<double>(to_u64(kernel) + to_u64(user)) / 1e7;
+#else
+        struct rusage   ru;
+        if( getrusage(RUSAGE_SELF, &ru) != 0 )
+            return 0;
+        return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+            + static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+#endif
+    }
+    /// CPU time of finished child processes (i.e. the C compiler) in seconds
+    double get_child_cpu_time()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        struct rusage   ru;
+        if( getrusage(RUSAGE_CHILDREN, &ru) != 0 )
+            return 0;
+        return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+            + static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+#endif
+    }
+    MemInfo get_mem_info()
+    {
+        MemInfo rv { 0, 0 };
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS pmc;
+        if( GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) )
+        {
+            rv.rss = pmc.WorkingSetSize;
+            rv.peak_rss = pmc.PeakWorkingSetSize;
+        }
+#else
+        struct rusage   ru;
+        if( getrusage(RUSAGE_SELF, &ru) == 0 )
+        {
+# ifdef __APPLE__
+            rv.peak_rss = static_cast<uint64_t>(ru.ru_maxrss);
+# else
+            rv.peak_rss = static_cast<uint64_t>(ru.ru_maxrss) * 1024;
+# endif
+        }
+# ifdef __linux__
+        if( FILE* fp = fopen("/proc/self/statm", "r") )
+        {
+            unsigned long   size, resident;
+            if( fscanf(fp, "%lu %lu", &size, &resident) == 2 )
+                rv.rss = static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            fclose(fp);
+        }
+# endif
+#endif
+        // The kernel's high-water mark can lag behind the current usage
+        if( rv.peak_rss < rv.rss )
+            rv.peak_rss = rv.rss;
+        return rv;
+    }
+    double secs_since(clock_t_::time_point start)
+    {
+        return ::std::chrono::duration<double>(clock_t_::now() - start).count();
+    }
+
+    void write_json_string(::std::ostream& os, const ::std::string& s)
+    {
+        os << '"';
+        for(char c : s)
+        {
+            switch(c)
+            {
+            case '"':   os << "\\\"";   break;
+            case '\\':  os << "\\\\";   break;
+            case '\n':  os << "\\n";    break;
+            case '\t':  os << "\\t";    break;
+            default:
+                if( static_cast<unsigned char>(c) < 0x20 )
+                    os << "\\u" << ::std::hex << ::std::setw(4) << ::std::setfill('0') << static_cast<int>(c) << ::std::dec << ::std::setfill(' ');
+                else
+                    os << c;
+                break;
+            }
+        }
+        os << '"';
+    }
+    void write_mem(::std::ostream& os, const MemInfo& m)
+    {
+        os << "\"rss_bytes\": " << m.rss << ", \"peak_rss_bytes\": " << m.peak_rss;
+    }
+}
+
+void TimeReport_Enable()
+{
+    s_enabled = true;
+    s_start_time = clock_t_::now();
+}
+bool TimeReport_IsEnabled()
+{
+    return s_enabled;
+}
+
+void TimeReport_PhaseBegin(const char* name)
+{
+    if( !s_enabled )
+        return ;
+    PhaseEnt    ent;
+    ent.name = name;
+    ent.depth = static_cast<unsigned>(s_phase_stack.size());
+    ent.wall_start = clock_t_::now();
+    ent.cpu_start = get_cpu_time();
+    ent.child_cpu_start = get_child_cpu_time();
+    ent.wall_s = 0;
+    ent.cpu_s = 0;
+    ent.child_cpu_s = 0;
+    ent.mem = MemInfo { 0, 0 };
+    s_phase_stack.push_back(s_phases.size());
+    s_phases.push_back(::std::move(ent));
+}
+void TimeReport_PhaseEnd()
+{
+    if( !s_enabled || s_phase_stack.empty() )
+        return ;
+    auto& ent = s_phases[s_phase_stack.back()];
+    s_phase_stack.pop_back();
+    ent.wall_s = secs_since(ent.wall_start);
+    ent.cpu_s = get_cpu_time() - ent.cpu_start;
+    ent.child_cpu_s = get_child_cpu_time() - ent.child_cpu_start;
+    ent.mem = get_mem_info();
+}
+void TimeReport_Checkpoint(const char* name)
+{
+    if( !s_enabled )
+        return ;
+    s_checkpoints.push_back(CheckpointEnt { name, secs_since(s_start_time), get_mem_info() });
+}
+
+void TimeReport_AddCount(const char* name, uint64_t count)
+{
+    if( !s_enabled )
+        return ;
+    ::std::lock_guard<::std::mutex> lh { s_counts_lock };
+    s_counts[name] += count;
+}
+
+bool TimeReport_Write(const ::std::string& path, const ::std::string& crate_name)
+{
+    ::std::ofstream os(path);
+    if( !os.good() )
+        return false;
+
+    auto total_mem = get_mem_info();
+    os << ::std::fixed << ::std::setprecision(6);
+    os << "{\n";
+    os << "  \"crate\": "; write_json_string(os, crate_name); os << ",\n";
+    os << "  \"total\": { \"wall_s\": " << secs_since(s_start_time) << ", \"cpu_s\": " << get_cpu_time() << ", \"child_cpu_s\": " << get_child_cpu_time() << ", "; write_mem(os, total_mem); os << " },\n";
+
+    os << "  \"phases\": [";
+    for(size_t i = 0; i < s_phases.size(); i ++)
+    {
+        const auto& p = s_phases[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    { \"name\": "; write_json_string(os, p.name);
+        os << ", \"depth\": " << p.depth << ", \"wall_s\": " << p.wall_s << ", \"cpu_s\": " << p.cpu_s << ", \"child_cpu_s\": " << p.child_cpu_s << ", ";
+        write_mem(os, p.mem);
+        os << " }";
+    }
+    os << "\n  ],\n";
+
+    os << "  \"checkpoints\": [";
+    for(size_t i = 0; i < s_checkpoints.size(); i ++)
+    {
+        const auto& c = s_checkpoints[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    { \"name\": "; write_json_string(os, c.name);
+        os << ", \"wall_s\": " << c.wall_s << ", ";
+        write_mem(os, c.mem);
+        os << " }";
+    }
+    os << "\n  ],\n";
+
+    os << "  \"counts\": {";
+    {
+        ::std::lock_guard<::std::mutex> lh { s_counts_lock };
+        bool first = true;
+        for(const auto& c : s_counts)
+        {
+            os << (first ? "\n" : ",\n");
+            first = false;
+            os << "    "; write_json_string(os, c.first); os << ": " << c.second;
+        }
+    }
+    os << "\n  }\n";
+    os << "}\n";
+    return os.good();
+}
+
+void ItemProfile_Enable(unsigned top_n)
+{
+    s_item_profile_enabled = true;
+    s_item_profile_top_n = top_n;
+}
+bool ItemProfile_IsEnabled()
+{
+    return s_item_profile_enabled;
+}
+void ItemProfile_Record(const char* category, const ::std::string& item, double seconds, ::std::initializer_list<::std::pair<const char*, uint64_t>> counters)
+{
+    if( !s_item_profile_enabled )
+        return ;
+    ::std::lock_guard<::std::mutex> lh { s_item_profile_lock };
+    auto& ent = s_item_profile[category][item];
+    ent.seconds += seconds;
+    ent.runs += 1;
+    for(const auto& c : counters)
+    {
+        auto it = ::std::find_if(ent.counters.begin(), ent.counters.end(), [&](const auto& x){ return ::std::strcmp(x.first, c.first) == 0; });
+        if( it == ent.counters.end() )
+            ent.counters.push_back(c);
+        else if( it->second < c.second )
+            it->second = c.second;
+    }
+}
+void ItemProfile_Print(::std::ostream& os)
+{
+    ::std::lock_guard<::std::mutex> lh { s_item_profile_lock };
+    for(const auto& cat : s_item_profile)
+    {
+        ::std::vector<const ::std::pair<const ::std::string, ItemProfileEnt>*> sorted;
+        double  total = 0;
+        for(const auto& e : cat.second)
+        {
+            sorted.push_back(&e);
+            total += e.second.seconds;
+        }
+        ::std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b){ return a->second.seconds > b->second.seconds; });
+
+        os << "Slowest items in " << cat.first << " (" << cat.second.size() << " items, "
+            << ::std::fixed << ::std::setprecision(3) << total << " s total):" << ::std::endl;
+        for(size_t i = 0; i < ::std::min<size_t>(sorted.size(), s_item_profile_top_n); i ++)
+        {
+            const auto& e = sorted[i]->second;
+            os << ::std::setw(10) << ::std::fixed << ::std::setprecision(3) << e.seconds * 1000 << " ms  ";
+            if( e.runs > 1 )
+                os << "runs=" << e.runs << " ";
+            for(const auto& c : e.counters)
+                os << c.first << "=" << c.second << " ";
+            os << sorted[i]->first << ::std::endl;
+        }
+    }
+}
@@ -27,7 +27,7 @@ void Trans_Codegen(const ::std::string& outfile, CodegenOutput out_ty, const Tra
     }
     else if( opt.mode == "c" )
     {
-        codegen = Trans_Codegen_GetGeneratorC(crate, outfile);
+        codegen = Trans_Codegen_GetGeneratorC(crate, outfile, opt);
     }
     else
     {
@@ -174,7 +174,11 @@ void Trans_Codegen(const ::std::string& outfile, CodegenOutput out_ty, const Tra
             bool is_extern = ! static_cast<bool>(fcn.m_code);
             // If this is a provided trait method, it needs to be monomorphised too.
             bool is_method = ( fcn.m_args.size() > 0 && visit_ty_with(fcn.m_args[0].second, [&](const auto& x){return x == ::HIR::TypeRef("Self",0xFFFF);}) );
-            if( pp.has_types() || is_method )
+            if( ent.second->fold_target )
+            {
+                codegen->emit_function_alias(path, fcn, pp, is_extern, *ent.second->fold_target);
+            }
+            else if( pp.has_types() || is_method )
             {
                 ASSERT_BUG(sp, ent.second->monomorphised.code, "Function that required monomorphisation wasn't monomorphised");
 
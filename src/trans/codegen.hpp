@@ -50,6 +50,8 @@ public:
     virtual void emit_function_ext(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params) {}
     virtual void emit_function_proto(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def) {}
     virtual void emit_function_code(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::MIR::FunctionPointer& code) {}
+    /// Emit a function that shares the code of `target` (see `Trans_FoldIdentical`)
+    virtual void emit_function_alias(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::HIR::Path& target) {}
 };
 
 struct Reloc {
@@ -86,6 +88,6 @@ struct EncodedLiteral {
 };
 EncodedLiteral Trans_EncodeLiteralAsBytes(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::Literal& lit, const ::HIR::TypeRef& ty);
 
-extern ::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile);
+extern ::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt);
 extern ::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGenerator_MonoMir(const ::HIR::Crate& crate, const ::std::string& outfile);
 
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <algorithm>
 #include <cmath>
+#include <limits>     // numeric_limits
 #include <hir/hir.hpp>
 #include <mir/mir.hpp>
 #include <hir_typeck/static.hpp>
@@ -18,6 +19,20 @@
 #include "target.hpp"
 #include "allocator.hpp"
 #include <iomanip>
+#include <parallel.hpp>
+#include <time_report.hpp>
+#include <mutex>
+#include <sha256.h>
+#include <cstdio>   // rename/remove
+#include <cstring>  // strlen
+#include <atomic>
+#include <sys/stat.h>   // stat/mkdir
+#ifdef _WIN32
+# include <direct.h>    // _mkdir
+# include <process.h>   // _getpid
+#else
+# include <unistd.h>    // getpid
+#endif
 
 namespace {
     struct FmtShell
@@ -98,6 +113,120 @@ namespace {
     };
 }
 
+namespace {
+    /// On-disk cache of compiled C objects, keyed on a hash of the compiler (version and command) and the source
+    class ObjectCache
+    {
+        ::std::string   m_dir;
+        /// Output of `$CC --version`, so a different compiler doesn't reuse objects
+        ::std::string   m_compiler_id;
+    public:
+        ObjectCache(::std::string dir):
+            m_dir(::std::move(dir))
+        {
+            if( !m_dir.empty() )
+            {
+                // Create the directory and any missing parents
+                for(size_t pos = 1; pos <= m_dir.size(); pos ++)
+                {
+                    if( pos == m_dir.size() || m_dir[pos] == '/' || m_dir[pos] == '\\' )
+                    {
+                        auto prefix = m_dir.substr(0, pos);
+#ifdef _WIN32
+                        _mkdir(prefix.c_str());
+#else
+                        mkdir(prefix.c_str(), 0755);
+#endif
+                    }
+                }
+                struct stat st;
+                if( stat(m_dir.c_str(), &st) != 0 || !(st.st_mode & S_IFDIR) )
+                {
+                    ::std::cerr << "warning: Unable to create object cache directory " << m_dir << ", not caching objects" << ::std::endl;
+                    m_dir.clear();
+                }
+            }
+        }
+
+        bool is_enabled() const { return !m_dir.empty(); }
+
+        /// Record the identity of the C compiler `cc` (the output of `cc --version`)
+        void set_compiler(const char* cc)
+        {
+            ::std::string   cmd = ::std::string("\"") + cc + "\" --version 2>&1";
+#ifdef _WIN32
+            FILE* fp = _popen(cmd.c_str(), "r");
+#else
+            FILE* fp = popen(cmd.c_str(), "r");
+#endif
+            m_compiler_id.clear();
+            if( fp )
+            {
+                char    buf[256];
+                size_t  n;
+                while( (n = fread(buf, 1, sizeof(buf), fp)) > 0 )
+                    m_compiler_id.append(buf, n);
+#ifdef _WIN32
+                _pclose(fp);
+#else
+                pclose(fp);
+#endif
+            }
+        }
+
+        /// Path of the cached object for a unit compiled with the given compiler arguments
+        /// - `extra_inputs` are other files that affect the compiled output (i.e. the shared header)
+        ::std::string get_path(const ::std::vector<const char*>& compile_args, const ::std::string& source, const ::std::vector<::std::string>& extra_inputs) const
+        {
+            helpers::Sha256 h;
+            h.update(m_compiler_id.data(), m_compiler_id.size() + 1);
+            for(const auto* a : compile_args) {
+                h.update(a, strlen(a) + 1);
+            }
+            h.update(helpers::Sha256::file_hex(source));
+            for(const auto& p : extra_inputs) {
+                h.update(helpers::Sha256::file_hex(p));
+            }
+            return m_dir + "/" + h.finalise_hex() + ".o";
+        }
+
+        /// Copy `src` to `dst`, writing to a temporary first so a partial copy is never visible at `dst`
+        static bool copy_file(const ::std::string& src, const ::std::string& dst)
+        {
+            ::std::ifstream is(src, ::std::ios::binary);
+            if( !is.good() )
+                return false;
+            // Units with the same key can be copied by several threads (or compiler processes) at once, so each copy
+            // needs its own temporary
+            static ::std::atomic<unsigned>  s_tmp_counter;
+#ifdef _WIN32
+            auto pid = _getpid();
+#else
+            auto pid = getpid();
+#endif
+            auto tmp = FMT(dst << "." << pid << "-" << s_tmp_counter++ << ".tmp");
+            {
+                ::std::ofstream os(tmp, ::std::ios::binary);
+                if( !os.good() )
+                    return false;
+                os << is.rdbuf();
+                if( !os.good() ) {
+                    os.close();
+                    remove(tmp.c_str());
+                    return false;
+                }
+            }
+            // NOTE: On windows, rename fails if the destination exists
+            remove(dst.c_str());
+            if( rename(tmp.c_str(), dst.c_str()) != 0 ) {
+                remove(tmp.c_str());
+                return false;
+            }
+            return true;
+        }
+    };
+}
+
 ::std::ostream& operator<<(::std::ostream& os, const FmtShell& x)
 {
     if( x.is_win )
@@ -185,7 +314,14 @@ namespace {
         ::std::string   m_outfile_path;
         ::std::string   m_outfile_path_c;
 
-        ::std::ofstream m_of;
+        // Number of files that function bodies are split across (1 = everything in `m_outfile_path_c`)
+        // - When >1, types/prototypes go in `<outfile>.h`, statics and shims in `<outfile>.c`, and function bodies in `<outfile>.cuN.c`
+        unsigned    m_codegen_units;
+        ::std::ofstream m_of_c;
+        ::std::ofstream m_of_h;
+        ::std::vector< ::std::unique_ptr<::std::ofstream> > m_of_units;
+        // Output stream, pointed at whichever of the above files is being written
+        ::std::ostream  m_of;
         const ::MIR::TypeResolve* m_mir_res;
 
         Compiler    m_compiler = Compiler::Gcc;
@@ -198,12 +334,14 @@ namespace {
         ::std::set< ::HIR::TypeRef> m_emitted_fn_types;
         ::std::set< const TypeRepr*>    m_embedded_tags;
     public:
-        CodeGenerator_C(const ::HIR::Crate& crate, const ::std::string& outfile):
+        CodeGenerator_C(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt):
             m_crate(crate),
             m_resolve(crate),
             m_outfile_path(outfile),
             m_outfile_path_c(outfile + ".c"),
-            m_of(m_outfile_path_c)
+            m_codegen_units(opt.codegen_units),
+            m_of_c(m_outfile_path_c),
+            m_of(m_of_c.rdbuf())
         {
             m_options.emulated_i128 = Target_GetCurSpec().m_backend_c.m_emulated_i128;
             switch(Target_GetCurSpec().m_backend_c.m_codegen_mode)
@@ -226,6 +364,27 @@ namespace {
                 break;
             }
 
+            // Only one command can be emitted with `-C emit-build-command`, and MSVC support for multiple units isn't
+            // implemented.
+            if( m_compiler != Compiler::Gcc || opt.build_command_file != "" )
+            {
+                m_codegen_units = 1;
+            }
+            if( m_codegen_units > 1 )
+            {
+                auto header_path = m_outfile_path + ".h";
+                auto slash_pos = header_path.find_last_of("/\\");
+                auto header_name = (slash_pos == ::std::string::npos ? header_path : header_path.substr(slash_pos+1));
+                m_of_h.open(header_path);
+                m_of_c << "#include \"" << header_name << "\"\n";
+                for(unsigned i = 0; i < m_codegen_units; i ++)
+                {
+                    m_of_units.push_back( ::std::make_unique<::std::ofstream>(FMT(m_outfile_path << ".cu" << i << ".c")) );
+                    *m_of_units.back() << "#include \"" << header_name << "\"\n";
+                }
+                m_of.rdbuf(m_of_h.rdbuf());
+            }
+
             m_of
                 << "/*\n"
                 << " * AUTOGENERATED by mrustc\n"
@@ -739,9 +898,45 @@ namespace {
 
         ~CodeGenerator_C() {}
 
+        /// Direct output to the main .c file (for definitions that must only be emitted once)
+        void select_output_main()
+        {
+            m_of.rdbuf(m_of_c.rdbuf());
+        }
+        /// Direct output to the codegen unit that holds the body of the function `p`
+        void select_output_function(const ::HIR::Path& p)
+        {
+            if( m_codegen_units > 1 )
+            {
+                // Partition by a hash of the symbol name, so a function stays in the same unit across rebuilds
+                // - FNV-1a, as `std::hash` isn't guaranteed to be stable
+                uint64_t h = 0xcbf29ce484222325ull;
+                for(char c : ::std::string(FMT(Trans_Mangle(p))))
+                {
+                    h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+                }
+                m_of.rdbuf(m_of_units[h % m_codegen_units]->rdbuf());
+            }
+        }
+        /// Get the linkage prefix for a function that is defined by this crate but also by other crates (e.g. a
+        /// generic instantiation)
+        const char* extern_def_linkage() const
+        {
+            if( m_codegen_units > 1 )
+            {
+                // Can't be `static` as it's called from other units
+                return "__attribute__((weak,visibility(\"hidden\"))) ";
+            }
+            else
+            {
+                return "static ";
+            }
+        }
+
         void finalise(const TransOptions& opt, CodegenOutput out_ty, const ::std::string& hir_file) override
         {
             const bool create_shims = (out_ty == CodegenOutput::Executable);
+            select_output_main();
 
             // TODO: Support dynamic libraries too
             // - No main, but has the rest.
@@ -875,7 +1070,19 @@ namespace {
             }
 
             m_of.flush();
-            m_of.close();
+            if( TimeReport_IsEnabled() )
+            {
+                uint64_t    c_bytes = static_cast<uint64_t>(m_of_c.tellp());
+                if( m_of_h.is_open() )
+                    c_bytes += static_cast<uint64_t>(m_of_h.tellp());
+                for(auto& of : m_of_units)
+                    c_bytes += static_cast<uint64_t>(of->tellp());
+                TimeReport_AddCount("c_bytes", c_bytes);
+            }
+            m_of_c.close();
+            m_of_h.close();
+            for(auto& of : m_of_units)
+                of->close();
 
             class LinkList: private StringList
             {
@@ -1105,6 +1312,12 @@ namespace {
             bool is_windows = false;
 #endif
             size_t  arg_file_start = 0;
+            size_t  compile_args_end = 0;
+            ::std::vector<::std::string>    unit_sources;
+            // - The cache isn't used when only emitting the build command (that has to be a single command)
+            ObjectCache object_cache { opt.build_command_file == "" ? opt.object_cache_dir : "" };
+            // Compile each C file to its own object (needed for codegen units, and so objects can be cached)
+            bool separate_compile = m_codegen_units > 1 || object_cache.is_enabled();
             switch( m_compiler )
             {
             case Compiler::Gcc:
@@ -1148,6 +1361,8 @@ namespace {
                     args.push_back("-g");
                 }
                 args.push_back("-fPIC");
+                // Arguments up to here are also used to compile the codegen units
+                compile_args_end = args.get_vec().size();
                 args.push_back("-o");
                 switch(out_ty)
                 {
@@ -1160,7 +1375,22 @@ namespace {
                     args.push_back(m_outfile_path+".o");
                     break;
                 }
-                args.push_back(m_outfile_path_c.c_str());
+                if( separate_compile )
+                {
+                    // Each file is compiled separately (see below), then linked/combined by this command
+                    unit_sources.push_back(m_outfile_path_c);
+                    if( m_codegen_units > 1 )
+                    {
+                        for(unsigned i = 0; i < m_codegen_units; i ++)
+                            unit_sources.push_back(FMT(m_outfile_path << ".cu" << i << ".c"));
+                    }
+                    for(const auto& src : unit_sources)
+                        args.push_back(src + ".o");
+                }
+                else
+                {
+                    args.push_back(m_outfile_path_c.c_str());
+                }
                 switch(out_ty)
                 {
                 case CodegenOutput::DynamicLibrary:
@@ -1205,7 +1435,16 @@ namespace {
                     break;
                 case CodegenOutput::StaticLibrary:
                 case CodegenOutput::Object:
-                    args.push_back("-c");
+                    if( separate_compile )
+                    {
+                        // Combine the unit objects into a single relocatable object
+                        args.push_back("-nostdlib");
+                        args.push_back("-r");
+                    }
+                    else
+                    {
+                        args.push_back("-c");
+                    }
                     break;
                 }
                 break;
@@ -1340,6 +1579,66 @@ namespace {
             }
             else
             {
+                if( !unit_sources.empty() )
+                {
+                    // Compile the main file and all codegen units (in parallel if `-j` was passed, or as many as the
+                    // jobserver from an outer make/minicargo allows)
+                    ::std::vector<int>  unit_results(unit_sources.size());
+                    ::std::mutex    output_lock;
+                    ::std::vector<const char*>  compile_args(args.get_vec().begin(), args.get_vec().begin() + compile_args_end);
+                    if( object_cache.is_enabled() )
+                    {
+                        object_cache.set_compiler(compile_args.front());
+                    }
+                    ::std::vector<::std::string>    cache_extra_inputs;
+                    if( m_codegen_units > 1 )
+                    {
+                        // All units include the shared header
+                        cache_extra_inputs.push_back(m_outfile_path + ".h");
+                    }
+                    Parallel_ForEachJob(unit_sources.size(), [&](unsigned , size_t idx) {
+                        const auto& src = unit_sources[idx];
+                        auto obj = src + ".o";
+                        ::std::string   cached_obj;
+                        if( object_cache.is_enabled() )
+                        {
+                            cached_obj = object_cache.get_path(compile_args, src, cache_extra_inputs);
+                            if( ObjectCache::copy_file(cached_obj, obj) )
+                            {
+                                ::std::lock_guard<::std::mutex> lh { output_lock };
+                                ::std::cout << "Using cached object " << cached_obj << " for " << src << ::std::endl;
+                                unit_results[idx] = 0;
+                                return ;
+                            }
+                        }
+
+                        ::std::stringstream unit_cmd_ss;
+                        for(const auto* a : compile_args)
+                        {
+                            unit_cmd_ss << "\"" << FmtShell(a, is_windows) << "\" ";
+                        }
+                        unit_cmd_ss << "-c -o \"" << FmtShell(obj, is_windows) << "\" \"" << FmtShell(src, is_windows) << "\"";
+                        {
+                            ::std::lock_guard<::std::mutex> lh { output_lock };
+                            ::std::cout << "Running command - " << unit_cmd_ss.str() << ::std::endl;
+                        }
+                        unit_results[idx] = system(unit_cmd_ss.str().c_str());
+
+                        if( unit_results[idx] == 0 && !cached_obj.empty() )
+                        {
+                            // Failing to populate the cache isn't fatal, the next build just misses
+                            ObjectCache::copy_file(obj, cached_obj);
+                        }
+                        });
+                    for(size_t idx = 0; idx < unit_sources.size(); idx ++)
+                    {
+                        if( unit_results[idx] != 0 )
+                        {
+                            ::std::cerr << "C Compiler failed to execute for " << unit_sources[idx] << " - error code " << unit_results[idx] << ::std::endl;
+                            exit(1);
+                        }
+                    }
+                }
                 int ec = system(cmd_ss.str().c_str());
                 if( ec == -1 )
                 {
@@ -2143,6 +2442,11 @@ namespace {
                 }
                 break;
             }
+            if( m_codegen_units > 1 )
+            {
+                // The header is included by multiple files, so can't contain a (tentative) definition
+                m_of << "extern ";
+            }
             emit_static_ty(type, p, /*is_proto=*/true);
             m_of << ";";
             m_of << "\t// static " << p << " : " << type;
@@ -2157,6 +2461,7 @@ namespace {
             m_mir_res = &top_mir_res;
 
             TRACE_FUNCTION_F(p);
+            select_output_main();
 
             auto type = params.monomorph(m_resolve, item.m_type);
             // statics that are zero do not require initializers, since they will be initialized to zero on program startup.
@@ -2224,6 +2529,14 @@ namespace {
                 m_of << "\t// static " << p << " : " << type << " = " << item.m_value_res;
                 m_of << "\n";
             }
+            else if( m_codegen_units > 1 )
+            {
+                // The prototype was `extern`, so emit a (zero-initialised) definition
+                emit_static_ty(type, p, /*is_proto=*/false);
+                m_of << ";";
+                m_of << "\t// static " << p << " : " << type;
+                m_of << "\n";
+            }
 
             m_mir_res = nullptr;
         }
@@ -2366,7 +2679,7 @@ namespace {
             }
             if( is_extern_def )
             {
-                m_of << "static ";
+                m_of << extern_def_linkage();
             }
             switch(item.m_linkage.type)
             {
@@ -2391,6 +2704,32 @@ namespace {
 
             m_mir_res = nullptr;
         }
+        void emit_function_alias(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::HIR::Path& target) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "/*alias*/ fn " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+            TRACE_FUNCTION_F(p << " = " << target);
+            MIR_ASSERT(*m_mir_res, m_compiler == Compiler::Gcc, "Function aliases are only supported with GCC");
+            // Aliases must be in the same translation unit as their target
+            select_output_function(target);
+            m_of << "// " << p << " (same code as " << target << ")\n";
+            // The C types differ when the Rust types only match in layout (e.g. two structs passed by value), which GCC
+            // (8 and later) warns about. Unknown-option warnings are ignored first, for compilers without this one.
+            m_of << "#pragma GCC diagnostic push\n";
+            m_of << "#pragma GCC diagnostic ignored \"-Wpragmas\"\n";
+            m_of << "#pragma GCC diagnostic ignored \"-Wunknown-warning-option\"\n";
+            m_of << "#pragma GCC diagnostic ignored \"-Wattribute-alias\"\n";
+            if( is_extern_def ) {
+                m_of << extern_def_linkage();
+            }
+            emit_function_header(p, item, params);
+            m_of << " __attribute__((alias(\"" << Trans_Mangle(target) << "\")));\n";
+            m_of << "#pragma GCC diagnostic pop\n";
+
+            m_mir_res = nullptr;
+        }
         void emit_function_code(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::MIR::FunctionPointer& code) override
         {
             TRACE_FUNCTION_F(p);
@@ -2405,9 +2744,10 @@ namespace {
             ::MIR::TypeResolve  mir_res { sp, m_resolve, FMT_CB(ss, ss << p;), ret_type, arg_types, *code };
             m_mir_res = &mir_res;
 
+            select_output_function(p);
             m_of << "// " << p << "\n";
             if( is_extern_def ) {
-                m_of << "static ";
+                m_of << extern_def_linkage();
             }
             emit_function_header(p, item, params);
             m_of << "\n";
@@ -6593,7 +6933,7 @@ namespace {
     Span CodeGenerator_C::sp;
 }
 
-::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile)
+::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt)
 {
-    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_C(crate, outfile));
+    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_C(crate, outfile, opt));
 }
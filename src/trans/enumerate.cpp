@@ -16,8 +16,11 @@
 #include <hir_typeck/static.hpp>    // StaticTraitResolve
 #include <hir/item_path.hpp>
 #include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include "target.hpp"
+#include <parallel.hpp>
 
 namespace {
     struct EnumState
@@ -57,27 +60,40 @@ void Trans_Enumerate_FillFrom_Literal(EnumState& state, const ::HIR::Literal& li
 void Trans_Enumerate_FillFrom_MIR(MIR::EnumCache& state, const ::MIR::Function& code);
 
 
+namespace {
+    /// Hash/equality through a pointer, for sets of borrowed items
+    struct PtrHash
+    {
+        template<typename T>
+        size_t operator()(const T* p) const { return ::std::hash<T>()(*p); }
+    };
+    struct PtrEq
+    {
+        template<typename T>
+        bool operator()(const T* lhs, const T* rhs) const { return *lhs == *rhs; }
+    };
+}
+
 namespace MIR {
     struct EnumCache
     {
+        // Unique items in first-seen order (the sets are only for de-duplication)
         ::std::vector<const ::HIR::Path*>  paths;
         ::std::vector<const ::HIR::TypeRef*>  typeids;
+        ::std::unordered_set<const ::HIR::Path*, PtrHash, PtrEq>    path_set;
+        ::std::unordered_set<const ::HIR::TypeRef*, PtrHash, PtrEq> typeid_set;
         EnumCache()
         {
         }
         void insert_path(const ::HIR::Path& new_path)
         {
-            for(const auto* p : this->paths)
-                if( *p == new_path )
-                    return ;
-            this->paths.push_back(&new_path);
+            if( this->path_set.insert(&new_path).second )
+                this->paths.push_back(&new_path);
         }
         void insert_typeid(const ::HIR::TypeRef& new_ty)
         {
-            for(const auto* p : this->typeids)
-                if( *p == new_ty )
-                    return ;
-            this->typeids.push_back(&new_ty);
+            if( this->typeid_set.insert(&new_ty).second )
+                this->typeids.push_back(&new_ty);
         }
 
         void apply(EnumState& state, const Trans_Params& pp) const
@@ -99,6 +115,17 @@ namespace MIR {
     }
 }
 
+/// Build the (parameter-independent) list of items used by a function's MIR
+::MIR::EnumCachePtr Trans_Enumerate_MakeCache(const ::MIR::Function& code)
+{
+    auto* esp = new MIR::EnumCache();
+    Trans_Enumerate_FillFrom_MIR(*esp, code);
+    // The sets are only needed while building, and the cache lives as long as the MIR
+    decltype(esp->path_set)().swap(esp->path_set);
+    decltype(esp->typeid_set)().swap(esp->typeid_set);
+    return ::MIR::EnumCachePtr(esp);
+}
+
 
 /// Enumerate trans items starting from `::main` (binary crate)
 TransList Trans_Enumerate_Main(const ::HIR::Crate& crate)
@@ -299,9 +326,12 @@ TransList Trans_Enumerate_Public(::HIR::Crate& crate)
                 Trans_Enumerate_Public_TraitImpl(state, resolve, trait_path, *impl);
             }
         }
-        for(auto& impl : impl_group.second.non_named)
+        for(auto& impl_list : impl_group.second.non_named)
         {
-            Trans_Enumerate_Public_TraitImpl(state, resolve, trait_path, *impl);
+            for(auto& impl : impl_list.second)
+            {
+                Trans_Enumerate_Public_TraitImpl(state, resolve, trait_path, *impl);
+            }
         }
         for(auto& impl : impl_group.second.generic)
         {
@@ -345,9 +375,12 @@ TransList Trans_Enumerate_Public(::HIR::Crate& crate)
             H1::enumerate_type_impl(state, *impl);
         }
     }
-    for(auto& impl : crate.m_type_impls.non_named)
+    for(auto& impl_grp : crate.m_type_impls.non_named)
     {
-        H1::enumerate_type_impl(state, *impl);
+        for(auto& impl : impl_grp.second)
+        {
+            H1::enumerate_type_impl(state, *impl);
+        }
     }
     for(auto& impl : crate.m_type_impls.generic)
     {
@@ -494,14 +527,31 @@ void Trans_Enumerate_Cleanup(const ::HIR::Crate& crate, TransList& list)
 void Trans_Enumerate_CommonPost_Run(EnumState& state)
 {
     // Run the enumerate queue (keeps the recursion depth down)
+    // - Processed a generation at a time: the MIR of every queued function is scanned in parallel (the result only
+    //   depends on the function, not the parameters), then the results are applied in queue order, so the output is
+    //   the same as draining the queue one item at a time.
     while( !state.fcn_queue.empty() )
     {
-        auto& fcn_out = *state.fcn_queue.front();
-        state.fcn_queue.pop_front();
+        ::std::deque<TransList_Function*>   queue;
+        ::std::swap(queue, state.fcn_queue);
 
-        TRACE_FUNCTION_F("Function " << ::std::find_if(state.rv.m_functions.begin(), state.rv.m_functions.end(), [&](const auto&x){ return x.second.get() == &fcn_out; })->first);
+        ::std::vector<const ::MIR::Function*>   to_scan;
+        ::std::unordered_set<const ::MIR::Function*>    seen;
+        for(const auto* fcn_out : queue)
+        {
+            const auto& mir = fcn_out->ptr->m_code.m_mir;
+            if( mir && !mir->trans_enum_state && seen.insert(&*mir).second )
+                to_scan.push_back(&*mir);
+        }
+        Parallel_ForEach(to_scan.size(), [&](unsigned /*worker*/, size_t idx) {
+            to_scan[idx]->trans_enum_state = Trans_Enumerate_MakeCache(*to_scan[idx]);
+            });
 
-        Trans_Enumerate_FillFrom(state, *fcn_out.ptr, fcn_out.pp);
+        for(auto* fcn_out : queue)
+        {
+            TRACE_FUNCTION_F("Function " << *fcn_out->path);
+            Trans_Enumerate_FillFrom(state, *fcn_out->ptr, fcn_out->pp);
+        }
     }
 }
 TransList Trans_Enumerate_CommonPost(EnumState& state)
@@ -526,8 +576,8 @@ namespace
         ::StaticTraitResolve    m_resolve;
         ::std::vector< ::std::pair< ::HIR::TypeRef, bool> >& out_list;
 
-        // TODO: Have a list of indexes into `out_list`, sorted by typeref ordering
-        ::std::vector<size_t>   visited_map;
+        /// Index into `out_list` for each visited type (keys are interned, so shared with `out_list`)
+        ::std::unordered_map< ::HIR::TypeRef, size_t>   visited_map;
         ::std::set< const ::HIR::TypeRef*, PtrComp> active_set;
 
         TypeVisitor(const ::HIR::Crate& crate, ::std::vector< ::std::pair< ::HIR::TypeRef, bool > >& out_list):
@@ -594,10 +644,10 @@ namespace
         {
             // If the type has already been visited, AND either this is a shallow visit, or the previous wasn't
             {
-                auto idx_it = ::std::lower_bound(visited_map.begin(), visited_map.end(), ty, [&](size_t i, const ::HIR::TypeRef& t){ return out_list[i].first < t; });
-                if( idx_it != visited_map.end() && out_list[*idx_it].first == ty)
+                auto idx_it = visited_map.find(ty);
+                if( idx_it != visited_map.end() )
                 {
-                    auto it = &out_list[*idx_it];
+                    auto it = &out_list[idx_it->second];
                     if( it->second == false || mode == Mode::Shallow )
                     {
                         // Return early
@@ -741,24 +791,25 @@ namespace
             }
 
             bool shallow = (mode == Mode::Shallow);
+            auto ty_i = ty.interned();
             {
-                auto idx_it = ::std::lower_bound(visited_map.begin(), visited_map.end(), ty, [&](size_t i, const ::HIR::TypeRef& t){ return out_list[i].first < t; });
-                if( idx_it == visited_map.end() || out_list[*idx_it].first != ty )
+                auto idx_it = visited_map.find(ty_i);
+                if( idx_it == visited_map.end() )
                 {
                     // Add a new entry
-                    visited_map.insert(idx_it, out_list.size());
+                    visited_map.insert(::std::make_pair(ty_i.clone(), out_list.size()));
                 }
                 else
                 {
                     // Previous visit was shallow, but this one isn't
                     // - Update the entry to the to-be-pushed entry with shallow=false
-                    if( !shallow && out_list[*idx_it].second )
+                    if( !shallow && out_list[idx_it->second].second )
                     {
-                        *idx_it = out_list.size();
+                        idx_it->second = out_list.size();
                     }
                 }
             }
-            out_list.push_back( ::std::make_pair(ty.clone(), shallow) );
+            out_list.push_back( ::std::make_pair(mv$(ty_i), shallow) );
             DEBUG("Add type " << ty << (shallow ? " (Shallow)": ""));
         }
 
@@ -1676,9 +1727,7 @@ void Trans_Enumerate_FillFrom(EnumState& state, const ::HIR::Function& function,
         const auto& mir_fcn = *function.m_code.m_mir;
         if( !mir_fcn.trans_enum_state )
         {
-            auto* esp = new MIR::EnumCache();
-            Trans_Enumerate_FillFrom_MIR(*esp, *function.m_code.m_mir);
-            mir_fcn.trans_enum_state = ::MIR::EnumCachePtr(esp);
+            mir_fcn.trans_enum_state = Trans_Enumerate_MakeCache(mir_fcn);
         }
         // TODO: Ensure that all types have drop glue generated too? (Iirc this is unconditional currently)
         mir_fcn.trans_enum_state->apply(state, pp);
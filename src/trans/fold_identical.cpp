@@ -0,0 +1,564 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * trans/fold_identical.cpp
+ * - Identical code folding of monomorphised functions
+ *
+ * Functions whose MIR is the same once types are reduced to their layout (e.g. `Vec<u32>::len` and `Vec<i32>::len`,
+ * which only differ in the type behind a pointer) only have one body emitted, the rest become aliases of it.
+ *
+ * NOTE: Drop glue (`TransList::m_drop_glue`) isn't folded, it's generated by codegen directly from the type (there's no
+ * MIR to compare).
+ */
+#include "main_bindings.hpp"
+#include "trans_list.hpp"
+#include "target.hpp"
+#include <hir/hir.hpp>
+#include <mir/mir.hpp>
+#include <mir/helpers.hpp>
+#include <hir_typeck/static.hpp>
+#include <parallel.hpp>
+#include <time_report.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+
+namespace {
+    struct Candidate
+    {
+        const ::HIR::Path*  path;
+        TransList_Function* ent;
+        bool    is_extern;
+        const ::MIR::Function*  code;
+        const ::HIR::TypeRef*   ret_ty;
+        const ::HIR::Function::args_t*  args;
+    };
+
+    typedef ::std::unordered_map<::HIR::Path, const ::HIR::Path*>   FoldMap;
+
+    const ::HIR::Path& get_canonical(const FoldMap& folded, const ::HIR::Path& p)
+    {
+        const ::HIR::Path* rv = &p;
+        for(;;)
+        {
+            auto it = folded.find(*rv);
+            if( it == folded.end() )
+                return *rv;
+            rv = it->second;
+        }
+    }
+
+    /// Builds the folding key for a function: the MIR with local types replaced by a description of their layout,
+    /// and the exact type recorded wherever an operation depends on it.
+    class KeyBuilder
+    {
+        const StaticTraitResolve&   m_resolve;
+        ::std::unordered_map<::HIR::TypeRef, ::std::string>&    m_sig_cache;
+        const FoldMap&  m_folded;
+        const ::HIR::Path&  m_self;
+        const ::MIR::TypeResolve&   m_mir_res;
+        ::std::ostringstream    m_os;
+        bool    m_ok = true;
+
+    public:
+        KeyBuilder(const StaticTraitResolve& resolve, ::std::unordered_map<::HIR::TypeRef, ::std::string>& sig_cache, const FoldMap& folded, const ::HIR::Path& self, const ::MIR::TypeResolve& mir_res):
+            m_resolve(resolve),
+            m_sig_cache(sig_cache),
+            m_folded(folded),
+            m_self(self),
+            m_mir_res(mir_res)
+        {
+        }
+
+        /// Returns an empty string if the function can't be folded
+        ::std::string build(const Candidate& c)
+        {
+            const auto& fcn = *c.ent->ptr;
+            const auto& code = *c.code;
+            m_os << fcn.m_abi << "/" << c.is_extern << "|";
+            // `()` is emitted as `void`, keep it distinct from other zero-sized types
+            if( *c.ret_ty == ::HIR::TypeRef::new_unit() )
+                m_os << "v";
+            else
+                m_os << type_sig(*c.ret_ty);
+            m_os << "(";
+            for(const auto& a : *c.args)
+                m_os << type_sig(a.second) << ",";
+            m_os << ")L";
+            for(const auto& ty : code.locals)
+                m_os << type_sig(ty) << ",";
+            m_os << "F";
+            for(bool v : code.drop_flags)
+                m_os << v;
+            for(const auto& blk : code.blocks)
+            {
+                m_os << "\nB";
+                for(const auto& stmt : blk.statements)
+                {
+                    write_stmt(stmt);
+                    m_os << ";";
+                }
+                write_term(blk.terminator);
+                if( !m_ok )
+                    return ::std::string();
+            }
+            return m_os.str();
+        }
+
+    private:
+        /// Description of a type's layout
+        /// - Primitives are exact, pointers only record the kind of metadata (the pointee is described wherever a
+        ///   dereference happens), and aggregates are their size/alignment, variant encoding and fields.
+        const ::std::string& type_sig(const ::HIR::TypeRef& ty)
+        {
+            auto it = m_sig_cache.find(ty);
+            if( it != m_sig_cache.end() )
+                return it->second;
+
+            static Span sp;
+            ::std::ostringstream    os;
+            auto exact = [&]{ os << "{" << ty << "}"; };
+            TU_MATCH_HDRA( (ty.data()), { )
+            default:
+                exact();
+            TU_ARMA(Diverge, te) {
+                os << "!";
+                }
+            TU_ARMA(Primitive, te) {
+                os << te;
+                }
+            TU_ARMA(Borrow, te) {
+                os << "P" << m_resolve.metadata_type(sp, te.inner);
+                }
+            TU_ARMA(Pointer, te) {
+                os << "P" << m_resolve.metadata_type(sp, te.inner);
+                }
+            TU_ARMA(Array, te) {
+                os << "A" << te.size.as_Known() << "(" << type_sig(te.inner) << ")";
+                }
+            TU_ARMA(Slice, te) {
+                os << "S(" << type_sig(te.inner) << ")";
+                }
+            TU_ARMA(Tuple, te) {
+                write_repr(os, ty);
+                }
+            TU_ARMA(Path, te) {
+                if( (te.binding.is_Struct() || te.binding.is_Enum() || te.binding.is_Union())
+                    && m_resolve.metadata_type(sp, ty) == MetadataType::None )
+                {
+                    write_repr(os, ty);
+                }
+                else
+                {
+                    exact();
+                }
+                }
+            }
+            return m_sig_cache.insert(::std::make_pair(ty.clone(), os.str())).first->second;
+        }
+        void write_repr(::std::ostream& os, const ::HIR::TypeRef& ty)
+        {
+            static Span sp;
+            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
+            if( !repr )
+            {
+                os << "{" << ty << "}";
+                return ;
+            }
+            os << (ty.data().is_Path() && ty.data().as_Path().binding.is_Union() ? "U" : "R") << repr->size << "," << repr->align;
+            TU_MATCH_HDRA( (repr->variants), { )
+            TU_ARMA(None, ve) {
+                }
+            TU_ARMA(Linear, ve) {
+                os << "l" << ve.field << "+" << ve.offset << "/" << ve.num_variants;
+                }
+            TU_ARMA(Values, ve) {
+                os << "v" << ve.field;
+                for(auto v : ve.values)
+                    os << ":" << v;
+                }
+            TU_ARMA(NonZero, ve) {
+                os << "z" << ve.field << "/" << ve.zero_variant;
+                }
+            }
+            os << "{";
+            for(const auto& f : repr->fields)
+                os << f.offset << ":" << type_sig(f.ty) << ";";
+            os << "}";
+        }
+        void write_exact(const ::HIR::TypeRef& ty)
+        {
+            m_os << "{" << ty << "}";
+        }
+        void write_path(const ::HIR::Path& p)
+        {
+            if( p == m_self )
+                m_os << "SELF";
+            else
+                m_os << get_canonical(m_folded, p);
+        }
+
+        void write_lvalue(const ::MIR::LValue& lv)
+        {
+            TU_MATCH_HDRA( (lv.m_root), { )
+            TU_ARMA(Return, e)  m_os << "R";
+            TU_ARMA(Argument, e)    m_os << "a" << e;
+            TU_ARMA(Local, e)   m_os << "l" << e;
+            TU_ARMA(Static, e) {
+                m_os << "S" << e;
+                }
+            }
+            // The layout of every step matters (e.g. a field's offset depends on the type it's in)
+            for(size_t i = 0; i < lv.m_wrappers.size(); i ++)
+            {
+                const auto& w = lv.m_wrappers[i];
+                switch(w.tag())
+                {
+                case ::MIR::LValue::Wrapper::TAGDEAD:   throw "";
+                case ::MIR::LValue::Wrapper::TAG_Deref:     m_os << "*";    break;
+                case ::MIR::LValue::Wrapper::TAG_Field:     m_os << "." << w.as_Field();    break;
+                case ::MIR::LValue::Wrapper::TAG_Downcast:  m_os << "#" << w.as_Downcast(); break;
+                case ::MIR::LValue::Wrapper::TAG_Index:     m_os << "[l" << w.as_Index() << "]";    break;
+                }
+                ::HIR::TypeRef  tmp;
+                m_os << "<" << type_sig(m_mir_res.get_lvalue_type(tmp, lv, lv.m_wrappers.size() - (i+1))) << ">";
+            }
+        }
+        void write_lvalue_exact(const ::MIR::LValue& lv)
+        {
+            ::HIR::TypeRef  tmp;
+            write_lvalue(lv);
+            write_exact(m_mir_res.get_lvalue_type(tmp, lv));
+        }
+        void write_constant(const ::MIR::Constant& c)
+        {
+            TU_MATCH_HDRA( (c), { )
+            TU_ARMA(Int, e) {
+                m_os << "i" << e.v << e.t;
+                }
+            TU_ARMA(Uint, e) {
+                m_os << "u" << e.v << e.t;
+                }
+            TU_ARMA(Float, e) {
+                uint64_t    bits;
+                ::std::memcpy(&bits, &e.v, sizeof(bits));
+                m_os << "f" << bits << e.t;
+                }
+            TU_ARMA(Bool, e) {
+                m_os << "b" << e.v;
+                }
+            TU_ARMA(Bytes, e) {
+                m_os << "B" << e.size() << ":";
+                for(auto b : e)
+                    m_os << static_cast<unsigned>(b) << ",";
+                }
+            TU_ARMA(StaticString, e) {
+                m_os << "s" << e.size() << ":" << e;
+                }
+            TU_ARMA(Const, e) {
+                m_os << "C" << *e.p;
+                }
+            TU_ARMA(Generic, e) {
+                m_ok = false;
+                }
+            TU_ARMA(ItemAddr, e) {
+                m_os << "&";
+                write_path(*e);
+                }
+            }
+        }
+        void write_param(const ::MIR::Param& p)
+        {
+            TU_MATCH_HDRA( (p), { )
+            TU_ARMA(LValue, e) {
+                write_lvalue(e);
+                }
+            TU_ARMA(Borrow, e) {
+                m_os << "&" << static_cast<int>(e.type);
+                write_lvalue(e.val);
+                }
+            TU_ARMA(Constant, e) {
+                write_constant(e);
+                }
+            }
+        }
+        void write_param_exact(const ::MIR::Param& p)
+        {
+            ::HIR::TypeRef  tmp;
+            write_param(p);
+            write_exact(m_mir_res.get_param_type(tmp, p));
+        }
+        void write_params(const ::std::vector<::MIR::Param>& vals)
+        {
+            m_os << "(";
+            for(const auto& v : vals)
+            {
+                write_param(v);
+                m_os << ",";
+            }
+            m_os << ")";
+        }
+        void write_rvalue(const ::MIR::RValue& rv)
+        {
+            TU_MATCH_HDRA( (rv), { )
+            TU_ARMA(Use, e) {
+                write_lvalue(e);
+                }
+            TU_ARMA(Borrow, e) {
+                m_os << "&" << static_cast<int>(e.type);
+                write_lvalue(e.val);
+                }
+            TU_ARMA(Constant, e) {
+                write_constant(e);
+                }
+            TU_ARMA(SizedArray, e) {
+                m_os << "[";
+                write_param(e.val);
+                m_os << ";" << e.count << "]";
+                }
+            TU_ARMA(Cast, e) {
+                m_os << "as";
+                write_lvalue_exact(e.val);
+                write_exact(e.type);
+                }
+            TU_ARMA(BinOp, e) {
+                m_os << "op" << static_cast<int>(e.op);
+                write_param_exact(e.val_l);
+                write_param_exact(e.val_r);
+                }
+            TU_ARMA(UniOp, e) {
+                m_os << "uop" << static_cast<int>(e.op);
+                write_lvalue_exact(e.val);
+                }
+            TU_ARMA(DstMeta, e) {
+                m_os << "meta";
+                write_lvalue(e.val);
+                }
+            TU_ARMA(DstPtr, e) {
+                m_os << "ptr";
+                write_lvalue(e.val);
+                }
+            TU_ARMA(MakeDst, e) {
+                m_os << "dst";
+                write_param(e.ptr_val);
+                write_param(e.meta_val);
+                }
+            TU_ARMA(Tuple, e) {
+                m_os << "T";
+                write_params(e.vals);
+                }
+            TU_ARMA(Array, e) {
+                m_os << "A";
+                write_params(e.vals);
+                }
+            // The type being created is the destination's type, so only the layout (already written) matters
+            TU_ARMA(UnionVariant, e) {
+                m_os << "U" << e.index;
+                write_param(e.val);
+                }
+            TU_ARMA(EnumVariant, e) {
+                m_os << "E" << e.index;
+                write_params(e.vals);
+                }
+            TU_ARMA(Struct, e) {
+                m_os << "S";
+                write_params(e.vals);
+                }
+            }
+        }
+        void write_stmt(const ::MIR::Statement& stmt)
+        {
+            TU_MATCH_HDRA( (stmt), { )
+            TU_ARMA(Assign, e) {
+                write_lvalue(e.dst);
+                m_os << "=";
+                write_rvalue(e.src);
+                }
+            TU_ARMA(Asm, e) {
+                m_ok = false;
+                }
+            TU_ARMA(SetDropFlag, e) {
+                m_os << "df" << e.idx << "=" << e.new_val << "^" << e.other;
+                }
+            TU_ARMA(Drop, e) {
+                // Drop glue is per-type
+                m_os << "drop" << static_cast<int>(e.kind) << "/" << e.flag_idx;
+                write_lvalue_exact(e.slot);
+                }
+            TU_ARMA(ScopeEnd, e) {
+                }
+            }
+        }
+        void write_term(const ::MIR::Terminator& term)
+        {
+            TU_MATCH_HDRA( (term), { )
+            TU_ARMA(Incomplete, e) {
+                m_ok = false;
+                }
+            TU_ARMA(Return, e) {
+                m_os << "ret";
+                }
+            TU_ARMA(Diverge, e) {
+                m_os << "diverge";
+                }
+            TU_ARMA(Goto, e) {
+                m_os << "goto" << e;
+                }
+            TU_ARMA(Panic, e) {
+                m_os << "panic" << e.dst;
+                }
+            TU_ARMA(If, e) {
+                m_os << "if";
+                write_lvalue(e.cond);
+                m_os << "?" << e.bb0 << ":" << e.bb1;
+                }
+            TU_ARMA(Switch, e) {
+                m_os << "switch";
+                write_lvalue(e.val);
+                for(auto t : e.targets)
+                    m_os << "," << t;
+                }
+            TU_ARMA(SwitchValue, e) {
+                m_os << "switchvalue";
+                write_lvalue_exact(e.val);
+                m_os << e.def_target;
+                for(auto t : e.targets)
+                    m_os << "," << t;
+                TU_MATCH_HDRA( (e.values), { )
+                TU_ARMA(Unsigned, ve) {
+                    for(auto v : ve)
+                        m_os << ":" << v;
+                    }
+                TU_ARMA(Signed, ve) {
+                    for(auto v : ve)
+                        m_os << ":" << v;
+                    }
+                TU_ARMA(String, ve) {
+                    for(const auto& v : ve)
+                        m_os << ":" << v.size() << ":" << v;
+                    }
+                }
+                }
+            TU_ARMA(Call, e) {
+                m_os << "call" << e.ret_block << "," << e.panic_block;
+                write_lvalue(e.ret_val);
+                TU_MATCH_HDRA( (e.fcn), { )
+                TU_ARMA(Value, fe) {
+                    write_lvalue_exact(fe);
+                    }
+                TU_ARMA(Path, fe) {
+                    write_path(fe);
+                    }
+                TU_ARMA(Intrinsic, fe) {
+                    m_os << fe.name << fe.params;
+                    }
+                }
+                write_params(e.args);
+                }
+            }
+        }
+    };
+}
+
+void Trans_FoldIdentical(const ::HIR::Crate& crate, const TransOptions& opt, TransList& list)
+{
+    static Span sp;
+
+    // Folded functions are emitted using GCC's `alias` attribute (which isn't available on Darwin)
+    if( opt.mode != "c" )
+        return ;
+    if( Target_GetCurSpec().m_backend_c.m_codegen_mode != CodegenMode::Gnu11 || Target_GetCurSpec().m_os_name == "macos" )
+        return ;
+
+    ::std::vector<Candidate>    candidates;
+    for(auto& ent : list.m_functions)
+    {
+        auto& fcn_ent = *ent.second;
+        if( !fcn_ent.ptr || !fcn_ent.ptr->m_code.m_mir || fcn_ent.force_prototype )
+            continue ;
+        const auto& fcn = *fcn_ent.ptr;
+        // Functions implementing an external symbol are renamed by the backend, and weak functions can be replaced
+        if( fcn.m_linkage.name != "" || fcn.m_linkage.type == ::HIR::Linkage::Type::Weak || fcn.m_variadic )
+            continue ;
+
+        Candidate   c;
+        c.path = &ent.first;
+        c.ent = &fcn_ent;
+        c.is_extern = !static_cast<bool>(fcn.m_code);
+        // Same selection as `Trans_Codegen`
+        if( fcn_ent.monomorphised.code )
+        {
+            c.code = &*fcn_ent.monomorphised.code;
+            c.ret_ty = &fcn_ent.monomorphised.ret_ty;
+            c.args = &fcn_ent.monomorphised.arg_tys;
+        }
+        else
+        {
+            c.code = &*fcn.m_code.m_mir;
+            c.ret_ty = &fcn.m_return;
+            c.args = &fcn.m_args;
+        }
+        auto is_unexpanded = [](const ::HIR::TypeRef& ty){ return ty.data().is_ErasedType() || ty.data().is_Generic(); };
+        if( visit_ty_with(*c.ret_ty, is_unexpanded) )
+            continue ;
+        if( ::std::any_of(c.args->begin(), c.args->end(), [&](const auto& a){ return visit_ty_with(a.second, is_unexpanded); }) )
+            continue ;
+        candidates.push_back(c);
+    }
+
+    ::std::vector<::std::unique_ptr<StaticTraitResolve>>    worker_resolves;
+    ::std::vector<::std::unordered_map<::HIR::TypeRef, ::std::string>>  worker_sig_caches( Parallel_GetThreadCount() );
+    for(unsigned i = 0; i < Parallel_GetThreadCount(); i ++)
+        worker_resolves.push_back(::std::make_unique<StaticTraitResolve>(crate));
+
+    FoldMap folded;
+    ::std::vector<bool> is_folded( candidates.size() );
+    ::std::vector<::std::string>    keys( candidates.size() );
+    // Repeat until nothing new folds, as each round can expose more folds in callers of newly folded functions
+    // - Terminates as every round that continues folds at least one more of the (finite) candidates
+    for(unsigned round = 0; ; round ++)
+    {
+        // `folded` is only read while keys are built
+        Parallel_ForEach(candidates.size(), [&](unsigned worker, size_t idx) {
+            if( is_folded[idx] )
+                return ;
+            const auto& c = candidates[idx];
+            ::MIR::TypeResolve  mir_res { sp, *worker_resolves[worker], FMT_CB(ss, ss << *c.path;), *c.ret_ty, *c.args, *c.code };
+            KeyBuilder  kb { *worker_resolves[worker], worker_sig_caches[worker], folded, *c.path, mir_res };
+            keys[idx] = kb.build(c);
+            });
+
+        // The first function (in path order) with a given key is the one that gets emitted
+        ::std::unordered_map<::std::string, size_t> first_with_key;
+        size_t  num_new = 0;
+        for(size_t i = 0; i < candidates.size(); i ++)
+        {
+            if( is_folded[i] || keys[i].empty() )
+                continue ;
+            auto ires = first_with_key.insert(::std::make_pair(::std::move(keys[i]), i));
+            if( !ires.second )
+            {
+                DEBUG(*candidates[i].path << " = " << *candidates[ires.first->second].path);
+                folded.insert(::std::make_pair( candidates[i].path->clone(), candidates[ires.first->second].path ));
+                is_folded[i] = true;
+                num_new += 1;
+            }
+        }
+        DEBUG("Round " << round << ": " << num_new << " folded");
+        if( num_new == 0 )
+            break;
+    }
+
+    for(size_t i = 0; i < candidates.size(); i ++)
+    {
+        if( is_folded[i] )
+        {
+            const auto& target = get_canonical(folded, *candidates[i].path);
+            // Point into the list's keys, which outlive this pass
+            candidates[i].ent->fold_target = &list.m_functions.find(target)->first;
+        }
+    }
+    TimeReport_AddCount("folded_functions", folded.size());
+}
@@ -19,6 +19,10 @@ struct TransOptions
     unsigned int opt_level = 0;
     bool emit_debug_info = false;
     ::std::string   build_command_file;
+    /// Number of C files to split function bodies across (compiled separately, then linked)
+    unsigned int codegen_units = 1;
+    /// Directory used to cache compiled C objects between runs (empty = disabled)
+    ::std::string   object_cache_dir;
 
     ::std::string   panic_crate;
 
@@ -44,4 +48,7 @@ extern void Trans_AutoImpls(::HIR::Crate& crate, TransList& trans_list);
 
 extern void Trans_Monomorphise_List(const ::HIR::Crate& crate, TransList& list);
 
+/// Find monomorphised functions with identical code, and mark all but one of each set to be emitted as aliases
+extern void Trans_FoldIdentical(const ::HIR::Crate& crate, const TransOptions& opt, TransList& list);
+
 extern void Trans_Codegen(const ::std::string& outfile, CodegenOutput out_ty, const TransOptions& opt, const ::HIR::Crate& crate, const TransList& list, const ::std::string& hir_file);
@@ -11,6 +11,7 @@
 #include <hir/hir.hpp>
 #include <mir/operations.hpp>   // Needed for post-monomorph checks and optimisations
 #include <hir_conv/constant_evaluation.hpp>
+#include <parallel.hpp>
 
 namespace {
     ::MIR::LValue monomorph_LValue(const ::StaticTraitResolve& resolve, const Trans_Params& params, const ::MIR::LValue& tpl)
@@ -337,8 +338,22 @@ namespace {
 void Trans_Monomorphise_List(const ::HIR::Crate& crate, TransList& list)
 {
     ::StaticTraitResolve    resolve { crate };
+
+    // Monomorphise and optimise functions in parallel
+    // - Each function's output only depends on its own (generic) MIR and the other generic MIR (for inlining), so the
+    //   result is the same no matter which worker handles it.
+    // - The resolver's caches aren't thread-safe, so each worker gets its own
+    ::std::vector<decltype(list.m_functions)::value_type*>  fcn_ents;
+    fcn_ents.reserve(list.m_functions.size());
     for(auto& fcn_ent : list.m_functions)
+        fcn_ents.push_back(&fcn_ent);
+    ::std::vector<::std::unique_ptr<StaticTraitResolve>>    worker_resolves;
+    for(unsigned i = 0; i < Parallel_GetThreadCount(); i ++)
+        worker_resolves.push_back(::std::make_unique<StaticTraitResolve>(crate));
+    Parallel_ForEach(fcn_ents.size(), [&](unsigned worker, size_t idx)
     {
+        auto& fcn_ent = *fcn_ents[idx];
+        const auto& resolve = *worker_resolves[worker];
         const auto& fcn = *fcn_ent.second->ptr;
         // Trait methods (which are the only case where `Self` can exist in the argument list at this stage) always need to be monomorphised.
         bool is_method = ( fcn.m_args.size() > 0 && visit_ty_with(fcn.m_args[0].second, [&](const auto& x){return x == ::HIR::TypeRef("Self",0xFFFF);}) );
@@ -368,7 +383,7 @@ void Trans_Monomorphise_List(const ::HIR::Crate& crate, TransList& list)
             fcn_ent.second->monomorphised.arg_tys = ::std::move(args);
             fcn_ent.second->monomorphised.code = ::std::move(mir);
         }
-    }
+    });
 
     // Also do constants and statics (stored in where?)
     // - NOTE: Done in reverse order, because consteval needs used constants to be evaluated
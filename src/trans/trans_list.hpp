@@ -83,11 +83,14 @@ struct TransList_Function
     CachedFunction  monomorphised;
     /// Forces the function to not be emited as code (just emit the signature)
     bool    force_prototype;
+    /// Has the same code as this function (set by `Trans_FoldIdentical`), emitted as an alias of it
+    const ::HIR::Path*  fold_target;
 
     TransList_Function(const ::HIR::Path& path):
         path(&path),
         ptr(nullptr),
-        force_prototype(false)
+        force_prototype(false),
+        fold_target(nullptr)
     {}
 };
 struct TransList_Static
@@ -0,0 +1,380 @@
+/*
+ * mrustc common tools
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/jobserver.cpp
+ * - GNU make jobserver client/server
+ */
+#include "jobserver.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+# include <unistd.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <errno.h>
+# include <sys/stat.h>
+# include <sys/ioctl.h>
+#endif
+
+namespace helpers {
+
+namespace {
+    /// Get the jobserver handle advertised in `flags` (the value of `$MAKEFLAGS`), empty if there isn't one
+    ::std::string get_jobserver_auth(const ::std::string& flags)
+    {
+        // The last instance of the option wins (`--jobserver-fds` is the pre-4.2 spelling)
+        ::std::string   auth;
+        size_t  auth_pos = 0;
+        for(const char* opt : { "--jobserver-fds=", "--jobserver-auth=" })
+        {
+            auto pos = flags.rfind(opt);
+            if( pos != ::std::string::npos && (auth.empty() || pos > auth_pos) )
+            {
+                auto start = pos + strlen(opt);
+                auth = flags.substr(start, flags.find(' ', start) - start);
+                auth_pos = pos;
+            }
+        }
+        return auth;
+    }
+    /// Report that the advertised jobserver can't be used (so this build doesn't share the outer job limit), and remove
+    /// it from `$MAKEFLAGS` so child processes don't repeat the warning
+    void drop_unsupported_jobserver(const ::std::string& flags, const ::std::string& auth)
+    {
+        fprintf(stderr, "warning: Unsupported GNU make jobserver '%s' (only pipes are supported), not sharing the job limit\n", auth.c_str());
+
+        ::std::string   new_flags;
+        for(size_t start = 0; start < flags.size(); )
+        {
+            auto end = ::std::min(flags.find(' ', start), flags.size());
+            auto word = flags.substr(start, end - start);
+            if( !word.empty() && word.compare(0, 16, "--jobserver-fds=") != 0 && word.compare(0, 17, "--jobserver-auth=") != 0 )
+            {
+                if( !new_flags.empty() )
+                    new_flags += " ";
+                new_flags += word;
+            }
+            start = end + 1;
+        }
+#ifdef _WIN32
+        _putenv_s("MAKEFLAGS", new_flags.c_str());
+#else
+        setenv("MAKEFLAGS", new_flags.c_str(), 1);
+#endif
+    }
+}
+
+#ifdef _WIN32
+// NOTE: GNU make on Windows passes the name of a semaphore (`--jobserver-auth=<name>`), which isn't supported. The tools
+// run without a jobserver, with a warning (see `drop_unsupported_jobserver`) if one is advertised.
+JobServer::~JobServer()
+{
+}
+::std::unique_ptr<JobServer> JobServer::from_environment()
+{
+    const char* makeflags = getenv("MAKEFLAGS");
+    if( !makeflags )
+        return nullptr;
+    auto auth = get_jobserver_auth(makeflags);
+    if( !auth.empty() )
+        drop_unsupported_jobserver(makeflags, auth);
+    return nullptr;
+}
+::std::unique_ptr<JobServer> JobServer::create(unsigned /*num_jobs*/)
+{
+    return nullptr;
+}
+bool JobServer::acquire()
+{
+    return false;
+}
+void JobServer::release()
+{
+}
+unsigned JobServer::max_jobs() const
+{
+    return 0;
+}
+#else
+
+namespace {
+    bool is_fifo(int fd)
+    {
+        struct stat s;
+        return fstat(fd, &s) == 0 && S_ISFIFO(s.st_mode);
+    }
+    void set_fd_flags(int fd, int fd_flags, int fl_flags)
+    {
+        fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | fd_flags);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | fl_flags);
+    }
+    /// Open a private non-blocking read handle to a pipe shared with other processes
+    /// - Setting O_NONBLOCK on the shared handle would affect every other process using it
+    int reopen_nonblocking(int fd)
+    {
+#ifdef __linux__
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/fd/%i", fd);
+        return open(path, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+#else
+        (void)fd;
+        return -1;
+#endif
+    }
+    bool write_token(int fd, char tok)
+    {
+        for(;;)
+        {
+            ssize_t rv = write(fd, &tok, 1);
+            if( rv == 1 )
+                return true;
+            if( rv < 0 && errno == EINTR )
+                continue;
+            // A non-blocking handle (e.g. a `fifo:` jobserver) can be momentarily full, wait for space instead of
+            // dropping the token (which would permanently shrink the build's job budget)
+            if( rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+            {
+                struct pollfd   pfd = { fd, POLLOUT, 0 };
+                if( poll(&pfd, 1, -1) >= 0 || errno == EINTR )
+                    continue;
+            }
+            return false;
+        }
+    }
+    /// Wake a thread waiting in `wait_token`, a full pipe already has a wakeup pending so that isn't an error
+    void write_wake(int fd)
+    {
+        char    c = 0;
+        while( write(fd, &c, 1) < 0 && errno == EINTR )
+            ;
+    }
+}
+
+JobServer::JobServer(int read_fd, int write_fd):
+    m_read_fd(read_fd),
+    m_read_shared_blocking(!(fcntl(read_fd, F_GETFL) & O_NONBLOCK)),
+    m_write_fd(write_fd),
+    m_max_jobs(0),
+    m_wake_fds { -1, -1 },
+    m_implicit_held(false),
+    m_reader_active(false)
+{
+    if( pipe(m_wake_fds) == 0 )
+    {
+        set_fd_flags(m_wake_fds[0], FD_CLOEXEC, O_NONBLOCK);
+        set_fd_flags(m_wake_fds[1], FD_CLOEXEC, O_NONBLOCK);
+    }
+}
+JobServer::~JobServer()
+{
+    // Hand back anything still held, so the rest of the build doesn't lose slots
+    for(char tok : m_tokens)
+        write_token(m_write_fd, tok);
+    for(int fd : m_owned_fds)
+        close(fd);
+    if( m_wake_fds[0] >= 0 )
+    {
+        close(m_wake_fds[0]);
+        close(m_wake_fds[1]);
+    }
+}
+
+::std::unique_ptr<JobServer> JobServer::from_environment()
+{
+    const char* makeflags = getenv("MAKEFLAGS");
+    if( !makeflags )
+        return nullptr;
+    ::std::string   flags = makeflags;
+    auto auth = get_jobserver_auth(flags);
+    if( auth.empty() )
+        return nullptr;
+
+    ::std::unique_ptr<JobServer>    rv;
+    if( auth.compare(0, 5, "fifo:") == 0 )
+    {
+        int fd = open(auth.c_str() + 5, O_RDWR|O_NONBLOCK|O_CLOEXEC);
+        if( fd < 0 )
+            return nullptr;
+        rv.reset(new JobServer(fd, fd));
+        rv->m_owned_fds.push_back(fd);
+    }
+    else
+    {
+        int read_fd, write_fd;
+        if( sscanf(auth.c_str(), "%i,%i", &read_fd, &write_fd) != 2 )
+        {
+            // E.g. a semaphore name from a Windows make
+            drop_unsupported_jobserver(flags, auth);
+            return nullptr;
+        }
+        // If the parent make didn't consider us a sub-make the descriptors are closed (or reused for something else)
+        if( !is_fifo(read_fd) || !is_fifo(write_fd) )
+            return nullptr;
+        int private_read_fd = reopen_nonblocking(read_fd);
+        rv.reset(new JobServer(private_read_fd >= 0 ? private_read_fd : read_fd, write_fd));
+        if( private_read_fd >= 0 )
+            rv->m_owned_fds.push_back(private_read_fd);
+    }
+
+    // GNU make also passes the slot count (e.g. ` -j8 --jobserver-auth=3,4`)
+    for(size_t pos = flags.find("-j"); pos != ::std::string::npos; pos = flags.find("-j", pos + 2))
+    {
+        if( pos > 0 && flags[pos-1] != ' ' )
+            continue ;
+        unsigned n = static_cast<unsigned>(strtoul(flags.c_str() + pos + 2, nullptr, 10));
+        if( n > 0 )
+            rv->m_max_jobs = n;
+    }
+    return rv;
+}
+
+::std::unique_ptr<JobServer> JobServer::create(unsigned num_jobs)
+{
+    int fds[2];
+    if( pipe(fds) != 0 )
+        return nullptr;
+    // The implicit slot is ours, the pipe holds the rest
+    for(unsigned i = 1; i < num_jobs; i ++)
+    {
+        if( !write_token(fds[1], '+') )
+        {
+            close(fds[0]);
+            close(fds[1]);
+            return nullptr;
+        }
+    }
+
+    int private_read_fd = reopen_nonblocking(fds[0]);
+    ::std::unique_ptr<JobServer>    rv { new JobServer(private_read_fd >= 0 ? private_read_fd : fds[0], fds[1]) };
+    rv->m_owned_fds.push_back(fds[0]);
+    rv->m_owned_fds.push_back(fds[1]);
+    if( private_read_fd >= 0 )
+        rv->m_owned_fds.push_back(private_read_fd);
+    rv->m_max_jobs = num_jobs;
+
+    // Advertise to child processes (the pipe descriptors are inherited)
+    ::std::string   makeflags;
+    if( const char* e = getenv("MAKEFLAGS") )
+    {
+        makeflags = e;
+        makeflags += " ";
+    }
+    char buf[128];
+    snprintf(buf, sizeof(buf), "-j%u --jobserver-fds=%i,%i --jobserver-auth=%i,%i", num_jobs, fds[0], fds[1], fds[0], fds[1]);
+    makeflags += buf;
+    setenv("MAKEFLAGS", makeflags.c_str(), 1);
+
+    return rv;
+}
+
+bool JobServer::acquire()
+{
+    ::std::unique_lock<::std::mutex>    lh { m_lock };
+    for(;;)
+    {
+        if( !m_implicit_held )
+        {
+            m_implicit_held = true;
+            return true;
+        }
+        if( m_reader_active )
+        {
+            m_cv.wait(lh);
+            continue;
+        }
+
+        // Only one thread reads from the jobserver at a time, the rest wait on the condvar
+        m_reader_active = true;
+        lh.unlock();
+        char tok = 0;
+        int rv = wait_token(tok);
+        lh.lock();
+        m_reader_active = false;
+        m_cv.notify_one();
+
+        if( rv > 0 )
+        {
+            // The implicit slot was released while waiting, prefer that and give the token back
+            if( !m_implicit_held )
+            {
+                write_token(m_write_fd, tok);
+                m_implicit_held = true;
+                return true;
+            }
+            m_tokens.push_back(tok);
+            return true;
+        }
+        if( rv < 0 )
+            return false;
+    }
+}
+void JobServer::release()
+{
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+    if( !m_tokens.empty() )
+    {
+        write_token(m_write_fd, m_tokens.back());
+        m_tokens.pop_back();
+    }
+    else
+    {
+        m_implicit_held = false;
+        if( m_reader_active && m_wake_fds[1] >= 0 )
+            write_wake(m_wake_fds[1]);
+        m_cv.notify_one();
+    }
+}
+
+unsigned JobServer::max_jobs() const
+{
+    return m_max_jobs;
+}
+
+int JobServer::wait_token(char& out)
+{
+    struct pollfd   pfds[2] = {
+        { m_read_fd, POLLIN, 0 },
+        { m_wake_fds[0], POLLIN, 0 },
+        };
+    int rv = poll(pfds, m_wake_fds[0] >= 0 ? 2 : 1, -1);
+    if( rv < 0 )
+        return errno == EINTR ? 0 : -1;
+
+    if( pfds[1].revents & POLLIN )
+    {
+        char buf[16];
+        while( read(m_wake_fds[0], buf, sizeof(buf)) > 0 )
+            ;
+        return 0;
+    }
+    if( pfds[0].revents & (POLLIN|POLLHUP) )
+    {
+        // A blocking handle (the pipe couldn't be reopened privately) would sit in `read` if another process took the
+        // token since the poll, and the wake pipe can't interrupt that - so only read when a byte is still queued.
+        // NOTE: This narrows the race to between here and the `read`, where losing it stalls this thread until the next
+        // token is returned to the pool (other threads can still take the implicit slot meanwhile)
+        if( m_read_shared_blocking && !(pfds[0].revents & POLLHUP) )
+        {
+            int avail = 0;
+            if( ioctl(m_read_fd, FIONREAD, &avail) == 0 && avail <= 0 )
+                return 0;
+        }
+        ssize_t n = read(m_read_fd, &out, 1);
+        if( n == 1 )
+            return 1;
+        if( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) )
+            return 0;
+        // EOF or error - the jobserver has gone away
+        return -1;
+    }
+    if( pfds[0].revents & (POLLERR|POLLNVAL) )
+        return -1;
+    return 0;
+}
+
+#endif
+
+}   // namespace helpers
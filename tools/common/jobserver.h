@@ -0,0 +1,85 @@
+/*
+ * mrustc common tools
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/jobserver.h
+ * - GNU make jobserver client/server (shares a job budget between nested build tools)
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#ifndef _WIN32
+# include <mutex>
+# include <condition_variable>
+#endif
+
+namespace helpers {
+
+/// Handle to a GNU make jobserver (see "POSIX Jobserver Interaction" in the GNU make manual)
+///
+/// Every process implicitly owns one job slot, additional slots are tokens read from a pipe (or FIFO) shared by all
+/// processes in the build. This handle hands out the implicit slot first, then tokens, and is thread-safe.
+class JobServer
+{
+#ifndef _WIN32
+    int m_read_fd;
+    bool    m_read_shared_blocking; // `m_read_fd` is a blocking handle shared with other processes (see `wait_token`)
+    int m_write_fd;
+    ::std::vector<int>  m_owned_fds;    // Closed on destruction
+    unsigned    m_max_jobs;
+    // Self-pipe used to wake a thread blocked waiting for a token when the implicit slot is released
+    int m_wake_fds[2];
+
+    ::std::mutex    m_lock;
+    ::std::condition_variable   m_cv;
+    bool    m_implicit_held;
+    bool    m_reader_active;
+    ::std::vector<char> m_tokens;   // Tokens currently held (returned verbatim on release)
+
+    JobServer(int read_fd, int write_fd);
+#endif
+public:
+    JobServer(const JobServer&) = delete;
+    JobServer& operator=(const JobServer&) = delete;
+    ~JobServer();
+
+    /// Connect to the jobserver advertised in `$MAKEFLAGS`, returns null if there isn't one (or it's unusable)
+    /// - Only the POSIX pipe/FIFO protocol is supported, on Windows this always returns null
+    static ::std::unique_ptr<JobServer> from_environment();
+    /// Create a new jobserver with `num_jobs` slots in total (including this process's implicit one)
+    /// - `$MAKEFLAGS` is updated so child processes (e.g. `make`, `mrustc`, `gcc -flto=jobserver`) join it
+    static ::std::unique_ptr<JobServer> create(unsigned num_jobs);
+
+    /// Block until a job slot is available, returns false if the jobserver failed (caller should run anyway)
+    bool acquire();
+    /// Release a slot obtained from `acquire`
+    void release();
+    /// Total number of slots in the jobserver (from `-j<n>`), zero if not known
+    unsigned max_jobs() const;
+
+    /// RAII wrapper around `acquire`/`release`
+    class Slot
+    {
+        JobServer*  m_js;
+    public:
+        Slot(JobServer* js):
+            m_js(js && js->acquire() ? js : nullptr)
+        {
+        }
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+        ~Slot() {
+            if(m_js)
+                m_js->release();
+        }
+    };
+#ifndef _WIN32
+private:
+    /// Wait for a token or a wakeup, returns 1 if a token was read into `out`, 0 if woken/interrupted, -1 on error
+    int wait_token(char& out);
+#endif
+};
+
+}   // namespace helpers
@@ -0,0 +1,41 @@
+/*
+ * mrustc common tools
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/sha256.h
+ * - SHA-256 hash (used for content-based caching)
+ */
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace helpers {
+
+/// Incremental SHA-256 hasher
+class Sha256
+{
+    uint32_t    m_state[8];
+    uint8_t     m_block[64];
+    size_t      m_block_len;
+    uint64_t    m_total_len;
+public:
+    Sha256();
+
+    void update(const void* data, size_t len);
+    void update(const ::std::string& s) {
+        update(s.data(), s.size());
+    }
+
+    /// Finish the hash and return the digest as a lower-case hex string
+    /// - The hasher should not be used after this is called
+    ::std::string finalise_hex();
+
+    /// Hash the contents of a file, returns an empty string if the file can't be read
+    static ::std::string file_hex(const ::std::string& path);
+private:
+    void process_block(const uint8_t* block);
+};
+
+}   // namespace helpers
@@ -4,6 +4,9 @@
 #include <macro_rules/macro_rules.hpp>
 #include <mir/mir.hpp>
 #include <mir/operations.hpp>   // MIR_Dump_Fcn
+#include <hir/serialise_lowlevel.hpp>   // Reader (for `--stats`)
+#include <chrono>
+#include <cstring>  // strcmp
 
 //int g_debug_indent_level = 0;
 
@@ -12,6 +15,8 @@ struct Args
     Args(int argc, const char* const argv[]);
 
     ::std::string   infile;
+    /// Print the container format, section sizes and load time instead of the crate contents
+    bool    stats = false;
 };
 
 struct Dumper
@@ -50,6 +55,22 @@ int main(int argc, const char* argv[])
 
     dumper.filters.types.functions = true;
 
+    if( args.stats )
+    {
+        // NOTE: HIR_Deserialise appends the extension itself
+        ::HIR::serialise::Reader    r { args.infile + ".hir" };
+        ::std::cout << "Format: " << (r.is_mapped() ? "uncompressed (mmap)" : "compressed (zlib)") << ::std::endl;
+        for(const auto& e : r.sections())
+        {
+            ::std::cout << "  " << ::HIR::serialise::section_name(e.id) << ": " << e.size << " bytes @ " << e.offset << ::std::endl;
+        }
+        auto start = ::std::chrono::steady_clock::now();
+        auto hir = HIR_Deserialise(args.infile);
+        auto end = ::std::chrono::steady_clock::now();
+        ::std::cout << "Load time: " << ::std::chrono::duration<double, ::std::milli>(end - start).count() << " ms" << ::std::endl;
+        return 0;
+    }
+
     auto hir = HIR_Deserialise(args.infile);
     dumper.dump_crate("", *hir);
 }
@@ -64,9 +85,12 @@ namespace {
                 cb(*impl);
             }
         }
-        for(const auto& impl : ig.non_named)
+        for(const auto& il : ig.non_named)
         {
-            cb(*impl);
+            for(const auto& impl : il.second)
+            {
+                cb(*impl);
+            }
         }
         for(const auto& impl : ig.generic)
         {
@@ -353,7 +377,19 @@ bool debug_enabled()
 
 Args::Args(int argc, const char* const argv[])
 {
-    this->infile = argv[1];
+    for(int i = 1; i < argc; i ++)
+    {
+        if( strcmp(argv[i], "--stats") == 0 ) {
+            this->stats = true;
+        }
+        else {
+            this->infile = argv[i];
+        }
+    }
+    if( this->infile == "" ) {
+        ::std::cerr << "Usage: dump_hirfile [--stats] <crate>" << ::std::endl;
+        exit(1);
+    }
 }
 /*
 // TODO: This is copy-pasted from src/main.cpp, should live somewhere better
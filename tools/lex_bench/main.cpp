@@ -0,0 +1,74 @@
+/*
+ * MRustC - Mutabah's Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * tools/lex_bench/main.cpp
+ * - Lexer throughput microbenchmark
+ *
+ * Repeatedly lexes a source file to completion and reports tokens and bytes per second.
+ */
+#include <parse/lex.hpp>
+#include <parse/tokentree.hpp>
+#include <ast/edition.hpp>
+#include <target_version.hpp>
+#include <debug_inner.hpp>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+
+TargetVersion	gTargetVersion = TargetVersion::Rustc1_29;
+
+int main(int argc, char* argv[])
+{
+    debug_init_phases("LEXBENCH_DEBUG", {
+        "Lex",
+        });
+
+    if( argc < 2 || argc > 3 )
+    {
+        ::std::cerr << "Usage: " << argv[0] << " <file.rs> [iterations]" << ::std::endl;
+        return 1;
+    }
+    ::std::string   path = argv[1];
+    unsigned    iterations = (argc > 2 ? ::std::strtoul(argv[2], nullptr, 10) : 10);
+    if( iterations == 0 )
+        iterations = 1;
+
+    size_t  n_bytes;
+    {
+        ::std::ifstream is(path, ::std::ios::binary | ::std::ios::ate);
+        if( !is.good() )
+        {
+            ::std::cerr << "Unable to open " << path << ::std::endl;
+            return 1;
+        }
+        n_bytes = static_cast<size_t>(is.tellg());
+    }
+
+    size_t  n_tokens = 0;
+    auto start = ::std::chrono::steady_clock::now();
+    for(unsigned i = 0; i < iterations; i ++)
+    {
+        Lexer   lex(path, ParseState(AST::Edition::Rust2018));
+        size_t  count = 0;
+        while( lex.getToken().type() != TOK_EOF )
+            count ++;
+        n_tokens = count;
+    }
+    auto end = ::std::chrono::steady_clock::now();
+
+    double total_ms = ::std::chrono::duration<double, ::std::milli>(end - start).count();
+    double per_iter_ms = total_ms / iterations;
+    ::std::cout << path << ": " << n_tokens << " tokens, " << n_bytes << " bytes" << ::std::endl;
+    ::std::cout << iterations << " iterations, " << per_iter_ms << " ms/iteration";
+    if( per_iter_ms > 0 )
+    {
+        ::std::cout
+            << ", " << (n_bytes / (1024.0 * 1024.0)) / (per_iter_ms / 1000.0) << " MB/s"
+            << ", " << n_tokens / (per_iter_ms / 1000.0) << " tokens/s"
+            ;
+    }
+    ::std::cout << ::std::endl;
+    return 0;
+}
@@ -22,6 +22,8 @@ extern int _putenv_s(const char*, const char*);
 #include "build.h"
 #include "debug.h"
 #include "stringlist.h"
+#include <jobserver.h>
+#include <sha256.h>
 #include <vector>
 #include <algorithm>
 #include <sstream>  // stringstream
@@ -35,6 +37,9 @@ extern int _putenv_s(const char*, const char*);
 #include <fstream>
 #include <climits>
 #include <cassert>
+#include <map>
+#include <chrono>
+#include <iomanip>  // setprecision
 #ifdef _WIN32
 # include <Windows.h>
 #else
@@ -62,37 +67,6 @@ extern int _putenv_s(const char*, const char*);
 #include <target_detect.h>	// tools/common/target_detect.h
 #define HOST_TARGET	DEFAULT_TARGET_NAME
 
-/// Class abstracting access to the compiler
-class Builder
-{
-    const BuildOptions& m_opts;
-    ::helpers::path m_compiler_path;
-    size_t m_total_targets;
-    mutable size_t m_targets_built;
-
-public:
-    Builder(const BuildOptions& opts, size_t total_targets);
-
-    bool build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index) const;
-    bool build_library(const PackageManifest& manifest, bool is_for_host, size_t index) const;
-    ::helpers::path build_build_script(const PackageManifest& manifest, bool is_for_host, bool* out_is_rebuilt) const;
-
-private:
-    ::helpers::path get_crate_path(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, const char** crate_type, ::std::string* out_crate_suffix) const;
-    bool spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile) const;
-
-    ::helpers::path build_and_run_script(const PackageManifest& manifest, bool is_for_host) const;
-
-    // If `is_for_host` and cross compiling, use a different directory
-    // - TODO: Include the target arch in the output dir too?
-    ::helpers::path get_output_dir(bool is_for_host) const {
-        if(is_for_host && m_opts.target_name != nullptr)
-            return m_opts.output_dir / "host";
-        else
-            return m_opts.output_dir;
-    }
-};
-
 class Timestamp
 {
 #if _WIN32
@@ -119,6 +93,24 @@ public:
         return Timestamp { 0 };
 #endif
     }
+    static Timestamp now() {
+#if _WIN32
+        FILETIME    out;
+        GetSystemTimeAsFileTime(&out);
+        return Timestamp { out };
+#else
+        return Timestamp { time(nullptr) };
+#endif
+    }
+    /// Raw value, for storing in a file (see `from_raw`)
+    unsigned long long to_raw() const {
+        return static_cast<unsigned long long>(m_val);
+    }
+    static Timestamp from_raw(unsigned long long v) {
+        Timestamp   rv = infinite_past();
+        rv.m_val = static_cast<decltype(rv.m_val)>(v);
+        return rv;
+    }
 
     bool operator==(const Timestamp& x) const {
         return m_val == x.m_val;
@@ -137,10 +129,109 @@ public:
     }
 };
 
+/// Class abstracting access to the compiler
+class Builder
+{
+    const BuildOptions& m_opts;
+    ::helpers::path m_compiler_path;
+    size_t m_total_targets;
+    mutable size_t m_targets_built;
+
+    // Time taken (seconds) to compile each crate, from previous runs and this one (see `estimate_build_time`)
+    // - Keyed by output file name (relative to the output directory)
+    mutable ::std::map<::std::string, double>   m_build_times;
+    mutable size_t  m_num_compiled;
+#ifndef DISABLE_MULTITHREAD
+    mutable ::std::mutex    m_build_times_mutex;
+#endif
+
+    // Hash of the compiler binary (empty if `MINICARGO_IGNTOOLS` is set)
+    ::std::string   m_compiler_hash;
+    // Cache of file content hashes for this run, keyed by path (with the timestamp the hash was taken at)
+    mutable ::std::map<::std::string, ::std::pair<Timestamp, ::std::string>>    m_file_hashes;
+#ifndef DISABLE_MULTITHREAD
+    mutable ::std::mutex    m_file_hashes_mutex;
+#endif
+
+    /// Hashes (hex SHA-256) identifying the inputs to a build, stored in `<outfile>.fingerprint`
+    struct Fingerprint {
+        // Compiler, arguments and environment
+        ::std::string   flags;
+        // `flags` plus the contents of everything listed in the depfile
+        ::std::string   full;
+        // An input may have changed after the compiler read it (so `full` can't be trusted)
+        bool    is_stale = false;
+    };
+    /// Hashes of a build's inputs taken before the compiler was started
+    struct InputSnapshot {
+        // When the snapshot was taken, anything modified since may differ from what the compiler read
+        Timestamp   taken;
+        // Input hash (see `get_input_hash`), keyed by path
+        ::std::map<::std::string, ::std::string>    hashes;
+
+        InputSnapshot(): taken(Timestamp::infinite_past()) {}
+    };
+
+public:
+    Builder(const BuildOptions& opts, size_t total_targets);
+
+    /// Estimated time to build the library of `manifest`, from the last time it was built (or the average of all known
+    /// crates if it's never been built)
+    double estimate_build_time(const PackageManifest& manifest, bool is_for_host) const;
+    /// Save the build times in the output directory, for use by the next run
+    void save_build_times() const;
+    /// Number of crates compiled so far (i.e. not skipped as up to date)
+    size_t num_compiled() const { return m_num_compiled; }
+
+    /// Build a target, `on_metadata_ready` is called (from the calling thread) once dependents can start compiling
+    /// against it (before it finishes, if the compiler supports signalling that)
+    bool build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index, const ::std::function<void()>& on_metadata_ready={}) const;
+    bool build_library(const PackageManifest& manifest, bool is_for_host, size_t index, const ::std::function<void()>& on_metadata_ready={}) const;
+    ::helpers::path build_build_script(const PackageManifest& manifest, bool is_for_host, bool* out_is_rebuilt) const;
+
+private:
+    ::helpers::path get_crate_path(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, const char** crate_type, ::std::string* out_crate_suffix) const;
+    ::std::string get_build_time_key(const ::helpers::path& outfile, bool is_for_host) const;
+    ::helpers::path get_build_times_path() const {
+        return m_opts.output_dir / "build_times.txt";
+    }
+
+    bool is_up_to_date(const ::helpers::path& outfile, const ::helpers::path& depfile, const ::helpers::path& fingerprint_file, const char* crate_type, const StringList& args, const StringListKV& env) const;
+    ::std::string get_flags_fingerprint(const StringList& args, const StringListKV& env) const;
+    InputSnapshot get_input_snapshot(const ::helpers::path& outfile, const ::helpers::path& depfile, const char* crate_type, const StringList& args) const;
+    Fingerprint get_fingerprint(const ::helpers::path& outfile, const ::helpers::path& depfile, const char* crate_type, const StringList& args, const StringListKV& env, const InputSnapshot* snapshot=nullptr) const;
+    ::std::string get_input_hash(const ::helpers::path& path, bool is_linked) const;
+    ::std::string get_file_hash(const ::helpers::path& path) const;
+    bool spawn_process_mrustc(const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::std::function<void()>& on_metadata_ready={}) const;
+
+    ::helpers::path build_and_run_script(const PackageManifest& manifest, bool is_for_host) const;
+
+    // If `is_for_host` and cross compiling, use a different directory
+    // - TODO: Include the target arch in the output dir too?
+    ::helpers::path get_output_dir(bool is_for_host) const {
+        if(is_for_host && m_opts.target_name != nullptr)
+            return m_opts.output_dir / "host";
+        else
+            return m_opts.output_dir;
+    }
+};
+
 #ifndef DISABLE_MULTITHREAD
 static ::std::mutex s_cout_mutex;
 #endif
 
+namespace {
+    /// Returns true if the package's library is a rlib, i.e. it only reads the metadata of its dependencies and
+    /// dependents only need its metadata (other crate types are linked)
+    bool library_is_rlib(const PackageManifest& manifest)
+    {
+        const auto& lib = manifest.get_library();
+        if( lib.m_crate_types.empty() )
+            return !lib.m_is_proc_macro;
+        return lib.m_crate_types.front() == PackageTarget::CrateType::rlib;
+    }
+}
+
 BuildList::BuildList(const PackageManifest& manifest, const BuildOptions& opts):
     m_root_manifest(manifest)
 {
@@ -252,14 +343,17 @@ BuildList::BuildList(const PackageManifest& manifest, const BuildOptions& opts):
     for(size_t i = 0; i < m_list.size(); i++)
     {
         const auto* cur = m_list[i].package;
+        bool cur_is_rlib = library_is_rlib(*cur);
         for(size_t j = i+1; j < m_list.size(); j ++)
         {
             const auto& p = *m_list[j].package;
+            // rlibs only need the metadata of rlib dependencies (proc macros have to be run, other types are linked)
+            bool needs_code = !cur_is_rlib || !library_is_rlib(p);
             for( const auto& dep : p.dependencies() )
             {
                 if( !dep.is_disabled() && &dep.get_package() == cur )
                 {
-                    m_list[i].dependents.push_back(static_cast<unsigned>(j));
+                    m_list[i].dependents.push_back({ static_cast<unsigned>(j), needs_code });
                 }
             }
             if( p.build_script() != "" && !opts.build_script_overrides.is_valid() )
@@ -268,7 +362,8 @@ BuildList::BuildList(const PackageManifest& manifest, const BuildOptions& opts):
                 {
                     if( !dep.is_disabled() && &dep.get_package() == cur )
                     {
-                        m_list[i].dependents.push_back(static_cast<unsigned>(j));
+                        // Build scripts are linked
+                        m_list[i].dependents.push_back({ static_cast<unsigned>(j), true });
                     }
                 }
             }
@@ -279,43 +374,129 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
 {
     bool include_build = !opts.build_script_overrides.is_valid();
     Builder builder { opts, m_list.size() };
+    // Keep the build times for the next run's scheduling, even if the build fails
+    struct BuildTimesSaver {
+        const Builder& builder;
+        ~BuildTimesSaver() {
+            builder.save_build_times();
+        }
+    } build_times_saver { builder };
 
     // Pre-count how many dependencies are remaining for each package
+    // - Builds are pipelined: a dependency is satisfied once its metadata is written, unless the dependent needs its
+    //   code (see `Dependent::needs_code`), in which case it (and everything it depends on) has to be fully built.
     struct BuildState
     {
+        // Dependencies that have to be satisfied before the package can be started
         ::std::vector<unsigned> num_deps_remaining;
+        // Dependencies that aren't yet fully built (along with all of their dependencies)
+        ::std::vector<unsigned> num_deps_unbuilt;
+        ::std::vector<bool> metadata_ready;
+        ::std::vector<bool> built;
         ::std::vector<unsigned> build_queue;
+        // Estimated time from starting each package to the end of the build (its build time plus the longest chain of
+        // dependents after it)
+        ::std::vector<double>   priority;
 
-        int complete_package(unsigned index, const ::std::vector<Entry>& list)
+        // When each package started/finished building (seconds since `build_start`), for reporting the critical path
+        ::std::chrono::steady_clock::time_point build_start;
+        ::std::vector<double>   start_time;
+        ::std::vector<double>   end_time;
+
+        double elapsed() const {
+            return ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - this->build_start).count();
+        }
+
+        /// Package's metadata has been written, returns the number of packages added to the queue
+        int complete_metadata(unsigned index, const ::std::vector<Entry>& list)
         {
+            if( this->metadata_ready[index] )
+                return 0;
+            this->metadata_ready[index] = true;
+            DEBUG("Metadata ready for " << list[index].package->name());
+
             int rv = 0;
+            for(const auto& d : list[index].dependents)
+            {
+                if( !d.needs_code )
+                    rv += this->satisfy_dependency(d.index, list);
+            }
+            return rv;
+        }
+        /// Package has finished building, returns the number of packages added to the queue
+        int complete_package(unsigned index, const ::std::vector<Entry>& list)
+        {
             DEBUG("Completed " << list[index].package->name() << " (" << list[index].dependents.size() << " dependents)");
-
-            for(auto d : list[index].dependents)
+            // If the compiler didn't signal early, the metadata is ready now
+            int rv = this->complete_metadata(index, list);
+            this->built[index] = true;
+            if( this->num_deps_unbuilt[index] == 0 )
             {
-                assert(this->num_deps_remaining[d] > 0);
-                this->num_deps_remaining[d] --;
-                DEBUG("- " << list[d].package->name() << " has " << this->num_deps_remaining[d] << " deps remaining");
-                if( this->num_deps_remaining[d] == 0 )
-                {
-                    rv ++;
-                    this->build_queue.push_back(d);
-                }
+                rv += this->complete_tree(index, list);
+            }
+            return rv;
+        }
+    private:
+        /// Package and everything it depends on is fully built
+        int complete_tree(unsigned index, const ::std::vector<Entry>& list)
+        {
+            int rv = 0;
+            for(const auto& d : list[index].dependents)
+            {
+                assert(this->num_deps_unbuilt[d.index] > 0);
+                this->num_deps_unbuilt[d.index] --;
+                if( d.needs_code )
+                    rv += this->satisfy_dependency(d.index, list);
+                // A dependent that only needed the metadata may have finished first
+                if( this->built[d.index] && this->num_deps_unbuilt[d.index] == 0 )
+                    rv += this->complete_tree(d.index, list);
             }
-
             return rv;
         }
+        int satisfy_dependency(unsigned d, const ::std::vector<Entry>& list)
+        {
+            assert(this->num_deps_remaining[d] > 0);
+            this->num_deps_remaining[d] --;
+            DEBUG("- " << list[d].package->name() << " has " << this->num_deps_remaining[d] << " deps remaining");
+            if( this->num_deps_remaining[d] == 0 )
+            {
+                this->build_queue.push_back(d);
+                return 1;
+            }
+            return 0;
+        }
+    public:
 
         unsigned get_next()
         {
             assert(!this->build_queue.empty());
-            unsigned rv = this->build_queue.back();
-            this->build_queue.pop_back();
+            // Start whatever has the most work queued up behind it, so long chains (e.g. core -> alloc -> std -> ...)
+            // don't end up waiting on leaf crates
+            auto it = ::std::max_element(this->build_queue.begin(), this->build_queue.end(), [&](unsigned a, unsigned b){
+                return this->priority[a] < this->priority[b];
+                });
+            unsigned rv = *it;
+            this->build_queue.erase(it);
             return rv;
         }
     };
     BuildState  state;
+    state.priority.resize(m_list.size());
+    // NOTE: Dependents are always later in the list
+    for(size_t i = m_list.size(); i --; )
+    {
+        double after = 0;
+        for(const auto& d : m_list[i].dependents)
+            after = ::std::max(after, state.priority[d.index]);
+        state.priority[i] = builder.estimate_build_time(*m_list[i].package, m_list[i].is_host) + after;
+        DEBUG("Package '" << m_list[i].package->name() << "' priority " << state.priority[i]);
+    }
+    state.build_start = ::std::chrono::steady_clock::now();
+    state.start_time.resize(m_list.size());
+    state.end_time.resize(m_list.size());
     state.num_deps_remaining.reserve(m_list.size());
+    state.metadata_ready.resize(m_list.size());
+    state.built.resize(m_list.size());
     for(const auto& e : m_list)
     {
         auto idx = static_cast<unsigned>(state.num_deps_remaining.size());
@@ -349,6 +530,7 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
         DEBUG("Package '" << p.name() << "' has " << n_deps << " dependencies and " << m_list[idx].dependents.size() << " dependents");
         state.num_deps_remaining.push_back( n_deps );
     }
+    state.num_deps_unbuilt = state.num_deps_remaining;
 
     // Actually do the build
     if( num_jobs > 1 )
@@ -408,7 +590,7 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
             }
         };
         struct H {
-            static void thread_body(unsigned my_idx, const ::std::vector<Entry>* list_p, Queue* queue_p, const Builder* builder)
+            static void thread_body(unsigned my_idx, const ::std::vector<Entry>* list_p, Queue* queue_p, const Builder* builder, ::helpers::JobServer* jobserver)
             {
                 const auto& list = *list_p;
                 auto& queue = *queue_p;
@@ -423,23 +605,56 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
                         break;
                     }
 
+                    bool ok;
                     unsigned cur;
                     {
-                        ::std::lock_guard<::std::mutex> sl { queue.mutex };
-                        cur = queue.state.get_next();
-                        queue.num_active ++;
+                        // Wait for a slot from the jobserver (shared with any outer make, and with mrustc's C compiler runs)
+                        // - Before picking the package, so the pick is the best one available once it can actually start
+                        ::helpers::JobServer::Slot  slot { jobserver };
+                        bool stop = false;
+                        {
+                            ::std::lock_guard<::std::mutex> sl { queue.mutex };
+                            // A build may have failed (or everything finished) while waiting for the slot
+                            if( queue.complete || queue.failure )
+                            {
+                                stop = true;
+                            }
+                            else
+                            {
+                                cur = queue.state.get_next();
+                                queue.state.start_time[cur] = queue.state.elapsed();
+                                queue.num_active ++;
+                            }
+                        }
+                        if( stop )
+                        {
+                            DEBUG("Thread " << my_idx << ": Terminating");
+                            break;
+                        }
+                        DEBUG("Thread " << my_idx << ": Starting " << cur << " - " << list[cur].package->name());
+                        ok = builder->build_library(*list[cur].package, list[cur].is_host, cur, [&]() {
+                            // Start anything that was only waiting for the metadata, while this finishes code generation
+                            ::std::lock_guard<::std::mutex> sl { queue.mutex };
+                            int v = queue.state.complete_metadata(cur, list);
+                            while(v--)
+                            {
+                                queue.avaliable_tasks.notify();
+                            }
+                            });
                     }
-
-                    DEBUG("Thread " << my_idx << ": Starting " << cur << " - " << list[cur].package->name());
-                    if( ! builder->build_library(*list[cur].package, list[cur].is_host, cur) )
+                    if( !ok )
                     {
-                        queue.failure = true;
+                        {
+                            ::std::lock_guard<::std::mutex> sl { queue.mutex };
+                            queue.failure = true;
+                        }
                         queue.signal_all();
                     }
                     else
                     {
                         ::std::lock_guard<::std::mutex> sl { queue.mutex };
                         queue.num_active --;
+                        queue.state.end_time[cur] = queue.state.elapsed();
                         int v = queue.state.complete_package(cur, list);
                         while(v--)
                         {
@@ -466,7 +681,7 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
         DEBUG("Spawning " << num_jobs << " worker threads");
         for(unsigned i = 0; i < num_jobs; i++)
         {
-            threads.push_back(::std::thread(H::thread_body, i, &this->m_list, &queue, &builder));
+            threads.push_back(::std::thread(H::thread_body, i, &this->m_list, &queue, &builder, opts.jobserver));
         }
 
         DEBUG("Poking jobs");
@@ -492,10 +707,12 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
         {
             auto cur = state.get_next();
 
+            state.start_time[cur] = state.elapsed();
             if( ! builder.build_library(*m_list[cur].package, m_list[cur].is_host, cur) )
             {
                 return false;
             }
+            state.end_time[cur] = state.elapsed();
             state.complete_package(cur, m_list);
         }
 #endif
@@ -506,10 +723,12 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
         {
             auto cur = state.get_next();
 
+            state.start_time[cur] = state.elapsed();
             if( ! builder.build_library(*m_list[cur].package, m_list[cur].is_host, cur) )
             {
                 return false;
             }
+            state.end_time[cur] = state.elapsed();
             state.complete_package(cur, m_list);
         }
     }
@@ -550,6 +769,43 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
         }
     }
 
+    // Report the chain of packages that determined the total build time
+    if( builder.num_compiled() > 0 && !m_list.empty() )
+    {
+        ::std::vector<::std::vector<unsigned>>  dependencies(m_list.size());
+        for(unsigned i = 0; i < m_list.size(); i ++)
+        {
+            for(const auto& d : m_list[i].dependents)
+                dependencies[d.index].push_back(i);
+        }
+        // Start from the last package to finish, and walk back through whichever dependency finished last
+        ::std::vector<unsigned> path;
+        unsigned cur = static_cast<unsigned>(::std::max_element(state.end_time.begin(), state.end_time.end()) - state.end_time.begin());
+        for(;;)
+        {
+            path.push_back(cur);
+            if( dependencies[cur].empty() )
+                break;
+            cur = *::std::max_element(dependencies[cur].begin(), dependencies[cur].end(), [&](unsigned a, unsigned b){
+                return state.end_time[a] < state.end_time[b];
+                });
+        }
+
+        // NOTE: Builds overlap when pipelined, so this is the span of the chain rather than the sum of the build times
+        double path_time = state.end_time[path.front()] - state.start_time[path.back()];
+        auto saved_flags = ::std::cout.flags();
+        auto saved_precision = ::std::cout.precision(1);
+        ::std::cout << ::std::fixed;
+        ::std::cout << "Critical path: " << path_time << "s of " << state.end_time[path.front()] << "s total" << ::std::endl;
+        for(auto it = path.rbegin(); it != path.rend(); ++it)
+        {
+            const auto& p = *m_list[*it].package;
+            ::std::cout << ::std::setw(8) << (state.end_time[*it] - state.start_time[*it]) << "s  " << p.name() << " v" << p.version() << ::std::endl;
+        }
+        ::std::cout.flags(saved_flags);
+        ::std::cout.precision(saved_precision);
+    }
+
     // Now that all libraries are done, build the binaries (if present)
     switch(opts.mode)
     {
@@ -571,9 +827,61 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
 Builder::Builder(const BuildOptions& opts, size_t total_targets):
     m_opts(opts),
     m_total_targets(total_targets),
-    m_targets_built(0)
+    m_targets_built(0),
+    m_num_compiled(0)
 {
     m_compiler_path = get_mrustc_path();
+    if( !getenv("MINICARGO_IGNTOOLS") )
+    {
+        m_compiler_hash = ::helpers::Sha256::file_hex(m_compiler_path.str());
+    }
+
+    // Load build times from the previous run (format: `<seconds> <key>` per line)
+    ::std::ifstream is( get_build_times_path().str() );
+    double  secs;
+    ::std::string   key;
+    while( is >> secs && ::std::getline(is >> ::std::ws, key) )
+    {
+        m_build_times[key] = secs;
+    }
+}
+
+::std::string Builder::get_build_time_key(const ::helpers::path& outfile, bool is_for_host) const
+{
+    if( is_for_host && m_opts.target_name != nullptr )
+        return "host/" + outfile.basename();
+    return outfile.basename();
+}
+double Builder::estimate_build_time(const PackageManifest& manifest, bool is_for_host) const
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_build_times_mutex };
+#endif
+    auto key = this->get_build_time_key(this->get_crate_path(manifest, manifest.get_library(), is_for_host, nullptr, nullptr), is_for_host);
+    auto it = m_build_times.find(key);
+    if( it != m_build_times.end() )
+        return it->second;
+    // Never built - assume it's average
+    if( m_build_times.empty() )
+        return 1.0;
+    double total = 0;
+    for(const auto& e : m_build_times)
+        total += e.second;
+    return total / m_build_times.size();
+}
+void Builder::save_build_times() const
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_build_times_mutex };
+#endif
+    if( m_num_compiled == 0 )
+        return ;
+    // NOTE: Failing to write isn't an error, the next run just schedules with less information
+    ::std::ofstream os( get_build_times_path().str() );
+    for(const auto& e : m_build_times)
+    {
+        os << e.second << " " << e.first << "\n";
+    }
 }
 
 ::helpers::path Builder::get_crate_path(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, const char** crate_type, ::std::string* out_crate_suffix) const
@@ -803,84 +1111,223 @@ namespace {
     }
 }
 
-bool Builder::build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index) const
+namespace {
+    /// Read the two hashes from a fingerprint file (empty strings if missing or malformed), and the time the inputs were
+    /// hashed (infinite past if not recorded, so the timestamp check always falls through to the content check)
+    void read_fingerprint_file(const ::helpers::path& path, ::std::string& out_flags, ::std::string& out_full, Timestamp& out_hashed_at)
+    {
+        ::std::ifstream is(path.str());
+        out_hashed_at = Timestamp::infinite_past();
+        if( !(is >> out_flags >> out_full) )
+        {
+            out_flags.clear();
+            out_full.clear();
+            return;
+        }
+        unsigned long long  raw;
+        if( is >> raw )
+            out_hashed_at = Timestamp::from_raw(raw);
+    }
+    void write_fingerprint_file(const ::helpers::path& path, const ::std::string& flags, const ::std::string& full, const Timestamp& hashed_at)
+    {
+        // NOTE: Failing to write just means the next run rebuilds
+        ::std::ofstream os(path.str());
+        os << flags << "\n" << full << "\n" << hashed_at.to_raw() << "\n";
+    }
+}
+
+bool Builder::is_up_to_date(const ::helpers::path& outfile, const ::helpers::path& depfile, const ::helpers::path& fingerprint_file, const char* crate_type, const StringList& args, const StringListKV& env) const
 {
-    const char* crate_type;
-    ::std::string   crate_suffix;
-    auto outfile = this->get_crate_path(manifest, target, is_for_host,  &crate_type, &crate_suffix);
-    auto depfile = outfile + ".d";
+    bool ign_tools = getenv("MINICARGO_IGNTOOLS") != nullptr;
+    auto ts_result = Timestamp::for_file(outfile);
+    if( ts_result == Timestamp::infinite_past() ) {
+        DEBUG("Building " << outfile << " - Missing");
+        return false;
+    }
 
-    size_t this_target_idx = (index != ~0u ? m_targets_built++ : ~0u);
+    auto depfile_ents = load_depfile(depfile);
+    auto it = depfile_ents.find(outfile);
+    static const ::std::vector<::helpers::path> s_no_inputs;
+    const auto& inputs = (it != depfile_ents.end() ? it->second : s_no_inputs);
 
-    // TODO: Determine if it needs re-running
-    // Rerun if:
-    // > `outfile` is missing
-    // > mrustc/minicargo is newer than `outfile`
-    // > build script has changed
-    // > any input file has changed (requires depfile from mrustc)
-    bool force_rebuild = false;
-    auto ts_result = Timestamp::for_file(outfile);
-    if( force_rebuild ) {
-        DEBUG("Building " << outfile << " - Force");
+    ::std::string   stored_flags, stored_full;
+    auto stored_hashed_at = Timestamp::infinite_past();
+    read_fingerprint_file(fingerprint_file, stored_flags, stored_full, stored_hashed_at);
+    if( stored_full.empty() )
+    {
+        // No fingerprint (e.g. built by an older minicargo) - just compare timestamps
+        if( !ign_tools && ts_result < Timestamp::for_file(m_compiler_path) ) {
+            DEBUG("Building " << outfile << " - Older than mrustc ( " << ts_result << " < " << Timestamp::for_file(m_compiler_path) << ")");
+            return false;
+        }
+        for(const auto& f : inputs)
+        {
+            if( ts_result < Timestamp::for_file(f) ) {
+                DEBUG("Building " << outfile << " - Older than " << f);
+                return false;
+            }
+        }
+        // Up to date, record the fingerprint so later checks can use it
+        auto hashed_at = Timestamp::now();
+        auto fp = this->get_fingerprint(outfile, depfile, crate_type, args, env);
+        write_fingerprint_file(fingerprint_file, fp.flags, fp.full, hashed_at);
+        return true;
     }
-    else if( ts_result == Timestamp::infinite_past() ) {
-        // Rebuild (missing)
-        DEBUG("Building " << outfile << " - Missing");
+
+    // Changed flags (compiler, arguments or environment) always need a rebuild, no need to look at the inputs
+    auto flags = this->get_flags_fingerprint(args, env);
+    if( flags != stored_flags )
+    {
+        DEBUG("Building " << outfile << " - Flags changed (" << stored_flags << " != " << flags << ")");
+        return false;
     }
-    else if( !getenv("MINICARGO_IGNTOOLS") && ( ts_result < Timestamp::for_file(m_compiler_path) /*|| ts_result < Timestamp::for_file("bin/minicargo")*/ ) ) {
-        // Rebuild (older than mrustc/minicargo)
-        DEBUG("Building " << outfile << " - Older than mrustc ( " << ts_result << " < " << Timestamp::for_file(m_compiler_path) << ")");
+
+    // First level: If nothing has been modified since the inputs were hashed, it's fresh
+    // NOTE: Equal timestamps go to the content check, as timestamps can be quite coarse
+    bool any_touched = !ign_tools && !(Timestamp::for_file(m_compiler_path) < stored_hashed_at);
+    for(const auto& f : inputs)
+    {
+        if( any_touched )
+            break;
+        any_touched = !(Timestamp::for_file(f) < stored_hashed_at);
     }
-    else {
-        // Check dependencies. (from depfile)
-        auto depfile_ents = load_depfile(depfile);
-        auto it = depfile_ents.find(outfile);
-        bool has_new_file = false;
-        if( it != depfile_ents.end() )
+    if( !any_touched )
+        return true;
+
+    // Second level: Compare the contents (e.g. after a checkout or a cache restore that changed timestamps)
+    auto hashed_at = Timestamp::now();
+    auto fp = this->get_fingerprint(outfile, depfile, crate_type, args, env);
+    if( fp.full != stored_full )
+    {
+        DEBUG("Building " << outfile << " - Fingerprint changed (" << stored_full << " != " << fp.full << ")");
+        return false;
+    }
+    // Re-write so the timestamp check passes next time
+    write_fingerprint_file(fingerprint_file, fp.flags, fp.full, hashed_at);
+    return true;
+}
+::std::string Builder::get_flags_fingerprint(const StringList& args, const StringListKV& env) const
+{
+    ::helpers::Sha256   h;
+    // NOTE: NUL separators, so the split between strings is part of the hash
+    h.update(m_compiler_hash.c_str(), m_compiler_hash.size() + 1);
+    for(const char* a : args.get_vec())
+    {
+        h.update(a, strlen(a) + 1);
+    }
+    for(auto kv : env)
+    {
+        h.update(kv.first, strlen(kv.first) + 1);
+        h.update(kv.second, strlen(kv.second) + 1);
+    }
+    return h.finalise_hex();
+}
+Builder::InputSnapshot Builder::get_input_snapshot(const ::helpers::path& outfile, const ::helpers::path& depfile, const char* crate_type, const StringList& args) const
+{
+    InputSnapshot   rv;
+    rv.taken = Timestamp::now();
+
+    // The inputs are only known for sure once the compiler has written the depfile, so use those from the last build
+    // (and the root file, in case there wasn't one)
+    bool is_linked = ::std::strcmp(crate_type, "rlib") != 0;
+    auto depfile_ents = load_depfile(depfile);
+    auto it = depfile_ents.find(outfile);
+    if( it != depfile_ents.end() )
+    {
+        for(const auto& f : it->second)
+            rv.hashes[f.str()] = this->get_input_hash(f, is_linked);
+    }
+    ::helpers::path root_file = args.get_vec().front();
+    rv.hashes[root_file.str()] = this->get_input_hash(root_file, is_linked);
+    return rv;
+}
+Builder::Fingerprint Builder::get_fingerprint(const ::helpers::path& outfile, const ::helpers::path& depfile, const char* crate_type, const StringList& args, const StringListKV& env, const InputSnapshot* snapshot/*=nullptr*/) const
+{
+    Fingerprint rv;
+    rv.flags = this->get_flags_fingerprint(args, env);
+
+    bool is_linked = ::std::strcmp(crate_type, "rlib") != 0;
+    ::helpers::Sha256   h;
+    h.update(rv.flags);
+    auto depfile_ents = load_depfile(depfile);
+    auto it = depfile_ents.find(outfile);
+    if( it != depfile_ents.end() )
+    {
+        for(const auto& f : it->second)
         {
-            for(const auto& f : it->second)
+            h.update(f.str().c_str(), f.str().size() + 1);
+            if( snapshot )
             {
-                auto dep_ts = Timestamp::for_file(f);
-                if( ts_result < dep_ts )
+                // Use the hash from before the build if there is one, as the file could have been edited while compiling
+                auto snap_it = snapshot->hashes.find(f.str());
+                if( snap_it != snapshot->hashes.end() )
                 {
-                    has_new_file = true;
-                    DEBUG("Rebuilding " << outfile << ", older than " << f);
-                    break;
+                    h.update(snap_it->second);
+                    continue ;
+                }
+                // A new source file (e.g. a module added since the last build) that's been touched since the build
+                // started may not be what the compiler read, so don't record it as up to date.
+                // NOTE: Crates aren't checked, they're built by us before anything that uses them is started
+                if( Timestamp::for_file(f + ".hir") == Timestamp::infinite_past() && !(Timestamp::for_file(f) < snapshot->taken) )
+                {
+                    DEBUG(f << " modified during the build of " << outfile);
+                    rv.is_stale = true;
                 }
             }
-        }
-
-        if( !has_new_file )
-        {
-            // Don't rebuild (no need to)
-            DEBUG("Not building " << outfile << " - not out of date");
-            return true;
+            h.update(this->get_input_hash(f, is_linked));
         }
     }
-
-    for(const auto& cmd : manifest.build_script_output().pre_build_commands)
+    rv.full = h.finalise_hex();
+    return rv;
+}
+::std::string Builder::get_input_hash(const ::helpers::path& path, bool is_linked) const
+{
+    // Crates are represented by their metadata (and object code if being linked), the file itself is just a marker
+    auto hir_file = path + ".hir";
+    if( !(Timestamp::for_file(hir_file) == Timestamp::infinite_past()) )
     {
-        // TODO: Run commands specified by build script (override)
-        TODO("Run command `" << cmd << "` from build script override");
+        auto rv = this->get_file_hash(hir_file);
+        if( is_linked )
+            rv += this->get_file_hash(path + ".o");
+        return rv;
     }
-
+    else
+    {
+        return this->get_file_hash(path);
+    }
+}
+::std::string Builder::get_file_hash(const ::helpers::path& path) const
+{
+    auto ts = Timestamp::for_file(path);
     {
 #ifndef DISABLE_MULTITHREAD
-        ::std::lock_guard<::std::mutex> lh { s_cout_mutex };
+        ::std::lock_guard<::std::mutex> lh { m_file_hashes_mutex };
 #endif
-        // TODO: Determine what number and total targets there are
-        if( index != ~0u ) {
-            //::std::cout << "(" << index << "/" << m_total_targets << ") ";
-            ::std::cout << "(" << this_target_idx << "/" << m_total_targets << ") ";
-        }
-        ::std::cout << "BUILDING ";
-        if(target.m_name != manifest.name())
-            ::std::cout << target.m_name << " from ";
-        ::std::cout << manifest.name() << " v" << manifest.version();
-        if( !manifest.active_features().empty() )
-            ::std::cout << " with features [" << manifest.active_features() << "]";
-        ::std::cout << ::std::endl;
+        auto it = m_file_hashes.find(path.str());
+        if( it != m_file_hashes.end() && it->second.first == ts )
+            return it->second.second;
+    }
+    // NOTE: Missing files hash to an empty string
+    auto hash = ::helpers::Sha256::file_hex(path.str());
+    {
+#ifndef DISABLE_MULTITHREAD
+        ::std::lock_guard<::std::mutex> lh { m_file_hashes_mutex };
+#endif
+        m_file_hashes.erase(path.str());
+        m_file_hashes.insert(::std::make_pair(path.str(), ::std::make_pair(ts, hash)));
     }
+    return hash;
+}
+
+bool Builder::build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index, const ::std::function<void()>& on_metadata_ready) const
+{
+    const char* crate_type;
+    ::std::string   crate_suffix;
+    auto outfile = this->get_crate_path(manifest, target, is_for_host,  &crate_type, &crate_suffix);
+    auto depfile = outfile + ".d";
+
+    size_t this_target_idx = (index != ~0u ? m_targets_built++ : ~0u);
+
     StringList  args;
     args.push_back(::helpers::path(manifest.manifest_path()).parent() / ::helpers::path(target.m_path));
     args.push_back("-o"); args.push_back(outfile);
@@ -997,10 +1444,62 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
     env.push_back("OUT_DIR", out_dir.str());
     push_env_common(env, manifest);
 
+    // Rebuild if:
+    // > `outfile` is missing
+    // > the fingerprint (compiler, flags, environment, and the contents of all inputs listed in the depfile) changed
+    // Timestamps are checked first, so the inputs are only hashed if something was touched since the last build
+    auto fingerprint_file = outfile + ".fingerprint";
+    if( this->is_up_to_date(outfile, depfile, fingerprint_file, crate_type, args, env) )
+    {
+        DEBUG("Not building " << outfile << " - not out of date");
+        return true;
+    }
+
+    for(const auto& cmd : manifest.build_script_output().pre_build_commands)
+    {
+        // TODO: Run commands specified by build script (override)
+        TODO("Run command `" << cmd << "` from build script override");
+    }
+
+    {
+#ifndef DISABLE_MULTITHREAD
+        ::std::lock_guard<::std::mutex> lh { s_cout_mutex };
+#endif
+        // TODO: Determine what number and total targets there are
+        if( index != ~0u ) {
+            //::std::cout << "(" << index << "/" << m_total_targets << ") ";
+            ::std::cout << "(" << this_target_idx << "/" << m_total_targets << ") ";
+        }
+        ::std::cout << "BUILDING ";
+        if(target.m_name != manifest.name())
+            ::std::cout << target.m_name << " from ";
+        ::std::cout << manifest.name() << " v" << manifest.version();
+        if( !manifest.active_features().empty() )
+            ::std::cout << " with features [" << manifest.active_features() << "]";
+        ::std::cout << ::std::endl;
+    }
+
     // TODO: If emitting command files (i.e. cross-compiling), concatenate the contents of `outfile + ".sh"` onto a
     // master file.
     // - Will probably want to do this as a final stage after building everything.
-    return this->spawn_process_mrustc(args, ::std::move(env), outfile + "_dbg.txt");
+    auto start_time = ::std::chrono::steady_clock::now();
+    // Hash the inputs before starting the compiler, so edits made while it runs aren't recorded as built
+    auto input_snapshot = this->get_input_snapshot(outfile, depfile, crate_type, args);
+    if( !this->spawn_process_mrustc(args, env, outfile + "_dbg.txt", on_metadata_ready) )
+        return false;
+    // NOTE: Calculated after the build, as the depfile (list of inputs) has just been written
+    auto fingerprint = this->get_fingerprint(outfile, depfile, crate_type, args, env, &input_snapshot);
+    // A stale fingerprint is recorded with an unmatchable hash, so the next run rebuilds
+    write_fingerprint_file(fingerprint_file, fingerprint.flags, fingerprint.is_stale ? "-" : fingerprint.full, input_snapshot.taken);
+    if( index != ~0u )
+    {
+#ifndef DISABLE_MULTITHREAD
+        ::std::lock_guard<::std::mutex> lh { m_build_times_mutex };
+#endif
+        m_build_times[this->get_build_time_key(outfile, is_for_host)] = ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start_time).count();
+        m_num_compiled ++;
+    }
+    return true;
 }
 ::helpers::path Builder::build_build_script(const PackageManifest& manifest, bool is_for_host, bool* out_is_rebuilt) const
 {
@@ -1074,7 +1573,7 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
     // TODO: If there's any dependencies marked as `links = foo` then grab `DEP_FOO_<varname>` from its metadata
     // (build script output)
 
-    if( this->spawn_process_mrustc(args, ::std::move(env), outfile + "_dbg.txt") )
+    if( this->spawn_process_mrustc(args, env, outfile + "_dbg.txt") )
     {
         *out_is_rebuilt = true;
         return outfile;
@@ -1171,7 +1670,7 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
 
     return out_file;
 }
-bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, size_t index) const
+bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, size_t index, const ::std::function<void()>& on_metadata_ready) const
 {
     if( manifest.build_script() != "" )
     {
@@ -1197,12 +1696,12 @@ bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, s
         }
     }
 
-    return this->build_target(manifest, manifest.get_library(), is_for_host, index);
+    return this->build_target(manifest, manifest.get_library(), is_for_host, index, on_metadata_ready);
 }
-bool Builder::spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile) const
+bool Builder::spawn_process_mrustc(const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::std::function<void()>& on_metadata_ready) const
 {
     //env.push_back("MRUSTC_DEBUG", "");
-    return spawn_process(m_compiler_path.str().c_str(), args, env, logfile);
+    return spawn_process(m_compiler_path.str().c_str(), args, env, logfile, {}, on_metadata_ready);
 }
 
 const helpers::path& get_mrustc_path()
@@ -1265,7 +1764,7 @@ const helpers::path& get_mrustc_path()
     return s_compiler_path;
 }
 
-bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory/*={}*/)
+bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory/*={}*/, const ::std::function<void()>& on_metadata_ready/*={}*/)
 {
 #ifdef _WIN32
     ::std::stringstream cmdline;
@@ -1390,11 +1889,23 @@ bool spawn_process(const char* exe_name, const StringList& args, const StringLis
     //    for(const auto& p : envp.get_vec())
     //        os << "\n " << p;
     //    });
-    envp.push_back(nullptr);
 
+    // Pipe for the child to signal that its metadata is ready on
+    int metadata_fds[2] = { -1, -1 };
     {
         static ::std::mutex    s_chdir_mutex;
         ::std::lock_guard<::std::mutex> lh { s_chdir_mutex };
+        if( on_metadata_ready && pipe(metadata_fds) == 0 )
+        {
+            // Close-on-exec so other children don't hold the pipe open (set under the lock, as every spawn takes it)
+            // - The child gets the write end in place of the read end's descriptor number, which is otherwise unused
+            fcntl(metadata_fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(metadata_fds[1], F_SETFD, FD_CLOEXEC);
+            posix_spawn_file_actions_adddup2(&fa, metadata_fds[1], metadata_fds[0]);
+            // NOTE: Not in `env`, as that's part of the build fingerprint
+            envp.push_back(::format("MRUSTC_METADATA_FD=", metadata_fds[0]));
+        }
+        envp.push_back(nullptr);
         auto fd_cwd = open(".", O_DIRECTORY);
         if( working_directory != ::helpers::path() ) {
             chdir(working_directory.str().c_str());
@@ -1404,6 +1915,11 @@ bool spawn_process(const char* exe_name, const StringList& args, const StringLis
             ::std::cerr << "Unable to run process '" << exe_name << "' - " << strerror(errno) << ::std::endl;
             DEBUG("Unable to spawn executable");
             posix_spawn_file_actions_destroy(&fa);
+            if( metadata_fds[0] >= 0 )
+            {
+                close(metadata_fds[0]);
+                close(metadata_fds[1]);
+            }
             return false;
         }
         if( working_directory != ::helpers::path() ) {
@@ -1411,6 +1927,21 @@ bool spawn_process(const char* exe_name, const StringList& args, const StringLis
         }
     }
     posix_spawn_file_actions_destroy(&fa);
+    if( metadata_fds[0] >= 0 )
+    {
+        close(metadata_fds[1]);
+        // Wait for either the signal, or EOF when the child exits (the child closes its end after signalling)
+        char    c;
+        ssize_t n;
+        while( (n = read(metadata_fds[0], &c, 1)) < 0 && errno == EINTR )
+            ;
+        close(metadata_fds[0]);
+        if( n == 1 )
+        {
+            DEBUG("Metadata ready");
+            on_metadata_ready();
+        }
+    }
     int status = -1;
     waitpid(pid, &status, 0);
     if( status != 0 )
@@ -9,10 +9,14 @@
 
 #include "manifest.h"
 #include <path.h>
+#include <functional>
 
 class StringList;
 class StringListKV;
 class Timestamp;
+namespace helpers {
+    class JobServer;
+}
 
 struct BuildOptions
 {
@@ -21,6 +25,8 @@ struct BuildOptions
     ::std::vector<::helpers::path>  lib_search_dirs;
     bool emit_mmir = false;
     const char* target_name = nullptr;  // if null, host is used
+    // GNU make jobserver shared with child processes (if null, only `num_jobs` limits parallelism)
+    ::helpers::JobServer*   jobserver = nullptr;
     enum class Mode {
         /// Build the binary/library
         Normal,
@@ -33,11 +39,19 @@ struct BuildOptions
 
 class BuildList
 {
+    struct Dependent
+    {
+        unsigned    index;  // Index into the list
+        // The dependent links against this package's code (e.g. it's a proc macro, or this is a build script
+        // dependency), so has to wait for this and everything it depends on to be fully built. Otherwise it can start
+        // as soon as this package's metadata is written.
+        bool    needs_code;
+    };
     struct Entry
     {
         const PackageManifest*  package;
         bool    is_host;
-        ::std::vector<unsigned> dependents;   // Indexes into the list
+        ::std::vector<Dependent> dependents;
     };
     const PackageManifest&  m_root_manifest;
     // List is sorted by build order
@@ -48,4 +62,7 @@ public:
 };
 
 extern const helpers::path& get_mrustc_path();
-extern bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory={});
+/// Run a process (with stdout going to `logfile`), returns true if it exited successfully
+/// - If `on_metadata_ready` is set, it's called if the process (mrustc) signals that it's written the crate metadata
+///   (via the pipe in `$MRUSTC_METADATA_FD`). Not supported on Windows.
+extern bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory={}, const ::std::function<void()>& on_metadata_ready={});
@@ -17,6 +17,11 @@
 #include <toml.h>   // TomlFile (workspace)
 #include <fstream>  // for workspace enumeration
 #include "cfg.hpp"
+#include <jobserver.h>
+#include <algorithm>    // max
+#ifndef __MINGW32__ // Mingw32 doesn't have c++11 threads
+# include <thread>  // hardware_concurrency
+#endif
 
 struct ProgramOptions
 {
@@ -46,6 +51,8 @@ struct ProgramOptions
 
     // Number of build jobs to run at a time
     unsigned build_jobs = 1;
+    // Set if `-j` was passed (otherwise the job count comes from an outer jobserver if present)
+    bool build_jobs_set = false;
 
     // Pause for user input before quitting (useful for MSVC debugging)
     bool pause_before_quit = false;
@@ -95,6 +102,25 @@ int main(int argc, const char* argv[])
 
         auto bs_override_dir = opts.override_directory ? ::helpers::path(opts.override_directory) : ::helpers::path();
 
+        // Share the job budget with an outer `make -j` if there is one, otherwise give child processes (mrustc and the
+        // C compiler it runs) a jobserver for our own `-j`. Done before anything is spawned (e.g. the target cfg probe), so
+        // an unusable jobserver in MAKEFLAGS is only reported once.
+        ::std::unique_ptr<::helpers::JobServer> jobserver;
+        if( opts.build_jobs > 0 )
+        {
+            jobserver = ::helpers::JobServer::from_environment();
+            if( jobserver )
+            {
+                if( !opts.build_jobs_set && jobserver->max_jobs() > 0 )
+                    opts.build_jobs = jobserver->max_jobs();
+                DEBUG("Using jobserver from MAKEFLAGS, " << opts.build_jobs << " jobs");
+            }
+            else if( opts.build_jobs > 1 )
+            {
+                jobserver = ::helpers::JobServer::create(opts.build_jobs);
+            }
+        }
+
         Cfg_SetTarget(opts.target);
 
         Debug_SetPhase("Load Overrides");
@@ -228,6 +254,8 @@ int main(int argc, const char* argv[])
             opts.test ? BuildOptions::Mode::Test :
             BuildOptions::Mode::Normal
             ;
+        build_opts.jobserver = jobserver.get();
+
         Debug_SetPhase("Enumerate Build");
         auto build_list = BuildList(m, build_opts);
         Debug_SetPhase("Run Build");
@@ -293,8 +321,11 @@ int ProgramOptions::parse(int argc, const char* argv[])
                 this->output_directory = argv[++i];
                 break;
             case 'j':
+                this->build_jobs_set = true;
                 if( i+1 == argc || argv[i+1][0] == '-' ) {
-                    // TODO: Detect number of CPU cores and use that many jobs
+#ifndef __MINGW32__
+                    this->build_jobs = ::std::max(1u, ::std::thread::hardware_concurrency());
+#endif
                     break;
                 }
                 this->build_jobs = ::std::strtol(argv[++i], nullptr, 10);
@@ -429,7 +460,8 @@ void ProgramOptions::help() const
         << "--vendor-dir <dir>       : Directory containing vendored packages (from `cargo vendor`)\n"
         << "--output-dir,-o <dir>    : Specify the compiler output directory\n"
         << "-L <dir>                 : Search for pre-built crates (e.g. libstd) in the specified directory\n"
-        << "-j <count>               : Run at most <count> build tasks at once (default is to run only one)\n"
+        << "-j [<count>]             : Run at most <count> build tasks at once (default is to run only one, or the\n"
+        << "                           limit from an outer `make -j`). Without <count>, use the number of CPUs\n"
         << "-n                       : Don't build any packages, just list the packages that would be built\n"
         ;
 }
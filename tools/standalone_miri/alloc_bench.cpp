@@ -0,0 +1,117 @@
+/*
+ * mrustc Standalone MIRI
+ * - by John Hodge (Mutabah)
+ *
+ * alloc_bench.cpp
+ * - Allocation relocation/validity tracking microbenchmark
+ *
+ * Models a `Vec<Box<T>>`: a buffer of pointers (each with a relocation) is filled, read back, grown by copying into
+ * a larger buffer, shuffled in place, and validity-checked. Reports the time for each phase at several sizes, so
+ * quadratic behaviour shows up as the per-element time growing with the size.
+ */
+#include "value.hpp"
+#include "hir_sim.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+namespace {
+    typedef ::std::chrono::steady_clock clock_t_;
+    double ms_since(clock_t_::time_point start)
+    {
+        return ::std::chrono::duration<double, ::std::milli>(clock_t_::now() - start).count();
+    }
+
+    void bench(size_t n)
+    {
+        double  t_fill, t_read, t_grow, t_shuffle, t_check;
+
+        auto buf = Allocation::new_alloc(n * POINTER_SIZE, "vec");
+        auto t = clock_t_::now();
+        for(size_t i = 0; i < n; i ++)
+        {
+            auto b = Allocation::new_alloc(16, "box");
+            b->write_u64(0, i);
+            b->write_u64(8, i);
+            buf->write_ptr(i * POINTER_SIZE, Allocation::PTR_BASE, RelocationPtr::new_alloc(::std::move(b)));
+        }
+        t_fill = ms_since(t);
+
+        t = clock_t_::now();
+        size_t  n_found = 0;
+        for(size_t i = 0; i < n; i ++)
+        {
+            auto v = buf->read_value(i * POINTER_SIZE, POINTER_SIZE);
+            if( v.get_relocation(0) && buf->get_relocation(i * POINTER_SIZE) )
+                n_found ++;
+        }
+        t_read = ms_since(t);
+        if( n_found != n )
+        {
+            ::std::cerr << "Relocation lookup failed (" << n_found << " of " << n << ")" << ::std::endl;
+            exit(1);
+        }
+
+        // Grow: copy the whole buffer (with relocations) into a new buffer twice the size
+        t = clock_t_::now();
+        auto buf2 = Allocation::new_alloc(2 * n * POINTER_SIZE, "vec2");
+        buf2->write_value(0, buf->read_value(0, n * POINTER_SIZE));
+        t_grow = ms_since(t);
+
+        // Shuffle: swap adjacent pairs
+        t = clock_t_::now();
+        for(size_t i = 0; i + 1 < n; i += 2)
+        {
+            auto a = buf2->read_value(i * POINTER_SIZE, POINTER_SIZE);
+            auto b = buf2->read_value((i+1) * POINTER_SIZE, POINTER_SIZE);
+            buf2->write_value(i * POINTER_SIZE, ::std::move(b));
+            buf2->write_value((i+1) * POINTER_SIZE, ::std::move(a));
+        }
+        t_shuffle = ms_since(t);
+
+        // Validity: check progressively longer prefixes of the initialised region
+        t = clock_t_::now();
+        for(size_t i = 0; i < n; i += 16)
+        {
+            buf2->check_bytes_valid(0, (i + 1) * POINTER_SIZE);
+        }
+        t_check = ms_since(t);
+
+        if( buf2->read_value(0, POINTER_SIZE).get_relocation(0) != buf->get_relocation(POINTER_SIZE) )
+        {
+            ::std::cerr << "Shuffle result incorrect" << ::std::endl;
+            exit(1);
+        }
+
+        ::std::cout << ::std::setw(8) << n << ::std::fixed << ::std::setprecision(2)
+            << ::std::setw(12) << t_fill
+            << ::std::setw(12) << t_read
+            << ::std::setw(12) << t_grow
+            << ::std::setw(12) << t_shuffle
+            << ::std::setw(12) << t_check
+            << ::std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ::std::vector<size_t>   sizes;
+    for(int i = 1; i < argc; i ++)
+        sizes.push_back(::std::strtoul(argv[i], nullptr, 10));
+    if( sizes.empty() )
+        sizes = { 1000, 4000, 16000 };
+
+    // Logging is always on, send it nowhere
+#ifdef _WIN32
+    DebugSink::set_output_file("NUL");
+#else
+    DebugSink::set_output_file("/dev/null");
+#endif
+
+    ::std::cout << "       n     fill_ms     read_ms     grow_ms  shuffle_ms    check_ms" << ::std::endl;
+    for(auto n : sizes)
+        bench(n);
+    return 0;
+}
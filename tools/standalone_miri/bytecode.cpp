@@ -0,0 +1,396 @@
+/*
+ * mrustc Standalone MIRI
+ * - by John Hodge (Mutabah)
+ *
+ * bytecode.cpp
+ * - Lowering of MIR function bodies into pre-decoded instructions
+ */
+#include "bytecode.hpp"
+#include "miri.hpp"
+#include "debug.hpp"
+
+namespace {
+    struct Lowerer
+    {
+        const GlobalState&  global;
+        const Function& fcn;
+        BytecodeFunction&   out;
+
+        /// Resolve an lvalue to a slot, returns false if it needs the general lvalue logic (statics, indexing,
+        /// unsized values, fat pointers, more than one deref)
+        bool get_slot(const ::MIR::LValue& lv, uint32_t& out_idx, ::HIR::TypeRef& out_ty)
+        {
+            BytecodeSlot    s;
+            s.deref = false;
+            s.idx = 0;
+            s.ofs = 0;
+            s.deref_ofs = 0;
+            const auto& root = lv.m_root;
+            if( root.is_Return() ) {
+                s.root = BytecodeSlot::Root::Return;
+                out_ty = fcn.ret_ty;
+            }
+            else if( root.is_Local() ) {
+                s.root = BytecodeSlot::Root::Local;
+                s.idx = root.as_Local();
+                out_ty = fcn.m_mir.locals.at(s.idx);
+            }
+            else if( root.is_Argument() ) {
+                s.root = BytecodeSlot::Root::Argument;
+                s.idx = root.as_Argument();
+                out_ty = fcn.args.at(s.idx);
+            }
+            else {
+                return false;
+            }
+            if( out_ty == RawType::Unreachable )
+                return false;
+
+            for(const auto& w : lv.m_wrappers)
+            {
+                if( w.is_Field() || w.is_Downcast() )
+                {
+                    size_t  ofs;
+                    out_ty = out_ty.get_field(w.is_Field() ? w.as_Field() : w.as_Downcast(), ofs);
+                    (s.deref ? s.deref_ofs : s.ofs) += static_cast<uint32_t>(ofs);
+                }
+                else if( w.is_Deref() )
+                {
+                    if( s.deref )
+                        return false;
+                    const auto* wrapper = out_ty.get_wrapper();
+                    if( !wrapper || (wrapper->type != TypeWrapper::Ty::Borrow && wrapper->type != TypeWrapper::Ty::Pointer) )
+                        return false;
+                    out_ty = out_ty.get_inner();
+                    if( out_ty.get_meta_type() != RawType::Unreachable )
+                        return false;
+                    s.deref = true;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            if( out_ty == RawType::Unreachable || out_ty.get_meta_type() != RawType::Unreachable )
+                return false;
+            s.size = static_cast<uint32_t>(out_ty.get_size());
+            if( s.size == 0 )
+                return false;
+
+            out_idx = static_cast<uint32_t>(out.slots.size());
+            out.slots.push_back(s);
+            return true;
+        }
+
+        /// Pre-build a primitive constant (same value as `MirHelpers::const_to_value`)
+        bool get_const(const ::MIR::Constant& c, uint32_t& out_idx, ::HIR::TypeRef& out_ty)
+        {
+            Value   val;
+            if( c.is_Int() ) {
+                const auto& ce = c.as_Int();
+                out_ty = ::HIR::TypeRef(ce.t);
+                val = Value(out_ty);
+                val.write_bytes(0, &ce.v, ::std::min(out_ty.get_size(), sizeof(ce.v)));
+            }
+            else if( c.is_Uint() ) {
+                const auto& ce = c.as_Uint();
+                out_ty = ::HIR::TypeRef(ce.t);
+                val = Value(out_ty);
+                val.write_bytes(0, &ce.v, ::std::min(out_ty.get_size(), sizeof(ce.v)));
+                if( ce.t.raw_type == RawType::U128 ) {
+                    uint64_t    zero = 0;
+                    val.write_bytes(8, &zero, 8);
+                }
+            }
+            else if( c.is_Bool() ) {
+                out_ty = ::HIR::TypeRef(RawType::Bool);
+                val = Value(out_ty);
+                val.write_bytes(0, &c.as_Bool().v, 1);
+            }
+            else if( c.is_Float() ) {
+                const auto& ce = c.as_Float();
+                out_ty = ::HIR::TypeRef(ce.t);
+                val = Value(out_ty);
+                if( ce.t.raw_type == RawType::F64 ) {
+                    val.write_bytes(0, &ce.v, sizeof(ce.v));
+                }
+                else if( ce.t.raw_type == RawType::F32 ) {
+                    float v = static_cast<float>(ce.v);
+                    val.write_bytes(0, &v, sizeof(v));
+                }
+                else {
+                    return false;
+                }
+            }
+            else {
+                return false;
+            }
+            // Only values stored inline, so copying one out doesn't allocate
+            if( val.m_inner.is_alloc )
+                return false;
+            out_idx = static_cast<uint32_t>(out.consts.size());
+            out.consts.push_back(::std::move(val));
+            return true;
+        }
+
+        bool get_operand(const ::MIR::Param& p, uint32_t& out_idx, ::HIR::TypeRef& out_ty)
+        {
+            if( p.is_LValue() )
+                return get_slot(p.as_LValue(), out_idx, out_ty);
+            if( p.is_Constant() && get_const(p.as_Constant(), out_idx, out_ty) ) {
+                out_idx |= BytecodeFunction::OPERAND_CONST;
+                return true;
+            }
+            return false;
+        }
+
+        /// Check that the fast path in `InterpreterThread::step_one` implements this operation
+        /// - Matches the operations supported by the general `BinOp` handling (anything else is left to that to report)
+        static bool is_fast_binop(::MIR::eBinOp op, RawType ty_l, RawType ty_r)
+        {
+            auto is_int = [](RawType t) {
+                switch(t)
+                {
+                case RawType::U8:   case RawType::U16:  case RawType::U32:  case RawType::U64:  case RawType::USize:
+                case RawType::I8:   case RawType::I16:  case RawType::I32:  case RawType::I64:  case RawType::ISize:
+                    return true;
+                default:
+                    return false;
+                }
+                };
+            switch(op)
+            {
+            case ::MIR::eBinOp::BIT_SHL:
+            case ::MIR::eBinOp::BIT_SHR:
+                switch(ty_l)
+                {
+                case RawType::U8:   case RawType::U16:  case RawType::U32:  case RawType::U64:
+                case RawType::USize:    case RawType::ISize:
+                    return is_int(ty_r);
+                default:
+                    return false;
+                }
+            case ::MIR::eBinOp::EQ: case ::MIR::eBinOp::NE:
+            case ::MIR::eBinOp::GT: case ::MIR::eBinOp::GE:
+            case ::MIR::eBinOp::LT: case ::MIR::eBinOp::LE:
+                return ty_l == ty_r && (is_int(ty_l) || ty_l == RawType::Bool || ty_l == RawType::Char);
+            case ::MIR::eBinOp::BIT_OR:
+            case ::MIR::eBinOp::BIT_AND:
+            case ::MIR::eBinOp::BIT_XOR:
+                return ty_l == ty_r && (is_int(ty_l) || ty_l == RawType::Bool);
+            case ::MIR::eBinOp::ADD:
+            case ::MIR::eBinOp::SUB:
+            case ::MIR::eBinOp::MUL:
+            case ::MIR::eBinOp::DIV:
+            case ::MIR::eBinOp::MOD:
+                if( ty_l != ty_r )
+                    return false;
+                switch(ty_l)
+                {
+                case RawType::U8:   case RawType::U16:  case RawType::U32:  case RawType::U64:  case RawType::USize:
+                case RawType::I32:  case RawType::I64:  case RawType::ISize:
+                    return true;
+                default:
+                    return false;
+                }
+            default:
+                return false;
+            }
+        }
+
+        BytecodeInstr lower_statement(const ::MIR::Statement& stmt)
+        {
+            BytecodeInstr   rv {};
+            rv.op = BytecodeOp::Generic;
+            if( stmt.is_SetDropFlag() )
+            {
+                const auto& se = stmt.as_SetDropFlag();
+                rv.op = BytecodeOp::SetDropFlag;
+                rv.a = se.idx;
+                rv.b = se.new_val;
+                rv.c = se.other;
+            }
+            else if( stmt.is_Drop() )
+            {
+                // Types without drop glue (see `InterpreterThread::drop_value`)
+                const auto& se = stmt.as_Drop();
+                ::HIR::TypeRef  ty;
+                uint32_t    slot;
+                if( se.kind != ::MIR::eDropKind::SHALLOW && get_slot(se.slot, slot, ty) )
+                {
+                    if( const auto* w = ty.get_wrapper() )
+                    {
+                        if( w->type == TypeWrapper::Ty::Pointer
+                            || (w->type == TypeWrapper::Ty::Borrow && w->size != static_cast<size_t>(::HIR::BorrowType::Move)) )
+                        {
+                            rv.op = BytecodeOp::Nop;
+                        }
+                    }
+                    else if( ty.inner_type != RawType::Composite && ty.inner_type != RawType::TraitObject )
+                    {
+                        rv.op = BytecodeOp::Nop;
+                    }
+                }
+            }
+            else if( stmt.is_Assign() )
+            {
+                const auto& se = stmt.as_Assign();
+                ::HIR::TypeRef  dst_ty;
+                uint32_t    dst;
+                if( !get_slot(se.dst, dst, dst_ty) )
+                    return rv;
+                const auto dst_size = out.slots[dst].size;
+
+                ::HIR::TypeRef  ty_l, ty_r;
+                uint32_t    src_l, src_r;
+                if( se.src.is_Use() )
+                {
+                    if( get_slot(se.src.as_Use(), src_l, ty_l) && out.slots[src_l].size == dst_size ) {
+                        rv.op = BytecodeOp::Copy;
+                        rv.a = dst;
+                        rv.b = src_l;
+                    }
+                }
+                else if( se.src.is_Constant() )
+                {
+                    if( get_const(se.src.as_Constant(), src_l, ty_l) && out.consts[src_l].size() == dst_size ) {
+                        rv.op = BytecodeOp::Const;
+                        rv.a = dst;
+                        rv.b = src_l;
+                    }
+                }
+                else if( se.src.is_BinOp() )
+                {
+                    const auto& re = se.src.as_BinOp();
+                    if( get_operand(re.val_l, src_l, ty_l) && get_operand(re.val_r, src_r, ty_r)
+                        && ty_l.get_wrapper() == nullptr && ty_r.get_wrapper() == nullptr
+                        && is_fast_binop(re.op, ty_l.inner_type, ty_r.inner_type) )
+                    {
+                        size_t  res_size;
+                        switch(re.op)
+                        {
+                        case ::MIR::eBinOp::EQ: case ::MIR::eBinOp::NE:
+                        case ::MIR::eBinOp::GT: case ::MIR::eBinOp::GE:
+                        case ::MIR::eBinOp::LT: case ::MIR::eBinOp::LE:
+                            res_size = 1;
+                            break;
+                        default:
+                            res_size = ty_l.get_size();
+                            break;
+                        }
+                        if( res_size == dst_size ) {
+                            rv.op = BytecodeOp::BinOp;
+                            rv.sub_op = static_cast<uint8_t>(re.op);
+                            rv.prim_l = static_cast<uint8_t>(ty_l.inner_type);
+                            rv.prim_r = static_cast<uint8_t>(ty_r.inner_type);
+                            rv.a = dst;
+                            rv.b = src_l;
+                            rv.c = src_r;
+                        }
+                    }
+                }
+            }
+            return rv;
+        }
+
+        BytecodeInstr lower_terminator(const ::MIR::Terminator& term)
+        {
+            BytecodeInstr   rv {};
+            rv.op = BytecodeOp::Generic;
+            switch(term.tag())
+            {
+            case ::MIR::Terminator::TAG_Goto:
+                rv.op = BytecodeOp::Goto;
+                rv.a = term.as_Goto();
+                break;
+            case ::MIR::Terminator::TAG_Return:
+                rv.op = BytecodeOp::Return;
+                break;
+            case ::MIR::Terminator::TAG_If: {
+                const auto& te = term.as_If();
+                ::HIR::TypeRef  ty;
+                uint32_t    cond;
+                if( get_slot(te.cond, cond, ty) && out.slots[cond].size == 1 ) {
+                    rv.op = BytecodeOp::If;
+                    rv.a = cond;
+                    rv.b = te.bb0;
+                    rv.c = te.bb1;
+                }
+                } break;
+            case ::MIR::Terminator::TAG_Call: {
+                // Direct calls to functions with bodies (same lookup as `InterpreterThread::call_path`), anything else
+                // (overrides, externs, intrinsics, function pointers) goes the long way.
+                const auto& te = term.as_Call();
+                if( !te.fcn.is_Path() )
+                    break;
+                const auto& path = te.fcn.as_Path();
+                if( global.m_fcn_overrides.count(path.n) )
+                    break;
+                const auto* callee = global.m_modtree.get_function_opt(path);
+                if( !callee )
+                    break;
+                if( callee->external.link_name != "" )
+                {
+                    callee = global.m_modtree.get_ext_function(callee->external.link_name.c_str());
+                    if( !callee )
+                        break;
+                }
+                rv.op = BytecodeOp::Call;
+                rv.a = static_cast<uint32_t>(out.callees.size());
+                out.callees.push_back(callee);
+                } break;
+            default:
+                break;
+            }
+            return rv;
+        }
+    };
+}
+
+BytecodeFunction BytecodeFunction::compile(const GlobalState& global, const Function& fcn)
+{
+    BytecodeFunction    rv;
+    Lowerer lower { global, fcn, rv };
+
+    const auto& blocks = fcn.m_mir.blocks;
+    rv.block_starts.reserve(blocks.size());
+    for(uint32_t bb_idx = 0; bb_idx < blocks.size(); bb_idx ++)
+    {
+        const auto& bb = blocks[bb_idx];
+        rv.block_starts.push_back(static_cast<uint32_t>(rv.code.size()));
+        for(uint32_t stmt_idx = 0; stmt_idx < bb.statements.size(); stmt_idx ++)
+        {
+            auto i = lower.lower_statement(bb.statements[stmt_idx]);
+            i.bb_idx = bb_idx;
+            i.stmt_idx = stmt_idx;
+            rv.code.push_back(i);
+        }
+        auto i = lower.lower_terminator(bb.terminator);
+        i.bb_idx = bb_idx;
+        i.stmt_idx = static_cast<uint32_t>(bb.statements.size());
+        rv.code.push_back(i);
+    }
+
+    // Convert block indexes into instruction indexes
+    for(auto& i : rv.code)
+    {
+        switch(i.op)
+        {
+        case BytecodeOp::Goto:
+            i.a = rv.block_starts.at(i.a);
+            break;
+        case BytecodeOp::If:
+            i.b = rv.block_starts.at(i.b);
+            i.c = rv.block_starts.at(i.c);
+            break;
+        case BytecodeOp::Generic:
+            rv.n_generic += 1;
+            break;
+        default:
+            break;
+        }
+    }
+    LOG_DEBUG("Bytecode for " << fcn.my_path << ": " << rv.code.size() << " instructions (" << rv.n_generic << " generic), "
+        << rv.slots.size() << " slots, " << rv.consts.size() << " constants");
+    return rv;
+}
@@ -0,0 +1,83 @@
+/*
+ * mrustc Standalone MIRI
+ * - by John Hodge (Mutabah)
+ *
+ * bytecode.hpp
+ * - Pre-decoded function bodies (HEADER)
+ *
+ * Each function's MIR is lowered (on first call) into a flat instruction list with lvalues resolved to slot/offset
+ * pairs, constants pre-built and callees looked up. `InterpreterThread::step_one` runs the simple instructions
+ * directly, anything else is handed back to the MIR interpreter.
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "value.hpp"
+
+struct Function;
+struct GlobalState;
+
+/// A resolved lvalue: a local/argument/return slot plus a constant offset, optionally through one thin pointer
+/// - `slot + ofs` normally, `*(slot + ofs) + deref_ofs` if `deref` is set
+struct BytecodeSlot
+{
+    enum class Root : uint8_t {
+        Return,
+        Local,
+        Argument,
+    }   root;
+    bool    deref;
+    uint32_t    idx;
+    uint32_t    ofs;
+    uint32_t    deref_ofs;
+    // Size of the referenced value
+    uint32_t    size;
+};
+
+enum class BytecodeOp : uint8_t
+{
+    Copy,   // slots[a] = slots[b]
+    Const,  // slots[a] = consts[b]
+    BinOp,  // slots[a] = operand(b) `sub_op` operand(c), for primitives of type `prim_l`/`prim_r`
+    SetDropFlag,    // drop_flags[a] = (c == ~0 ? false : drop_flags[c]) != b
+    Nop,    // Statement with no effect (e.g. dropping a borrow)
+    Goto,   // pc = a
+    If,     // pc = (slots[a] ? b : c)
+    Return,
+    Call,   // Call callees[a], arguments and return slot are from the MIR terminator
+    Generic,    // Run this statement/terminator through the MIR interpreter
+};
+
+struct BytecodeInstr
+{
+    BytecodeOp  op;
+    uint8_t sub_op; // `::MIR::eBinOp`
+    uint8_t prim_l; // `RawType`
+    uint8_t prim_r;
+    // Source location, kept in the stack frame for the MIR interpreter and error reporting
+    // - `stmt_idx` is the number of statements for the terminator
+    uint32_t    bb_idx;
+    uint32_t    stmt_idx;
+    uint32_t    a, b, c;
+};
+
+struct BytecodeFunction
+{
+    /// Flag on a BinOp operand indicating that it's an index into `consts` instead of `slots`
+    static const uint32_t OPERAND_CONST = 1u << 31;
+
+    ::std::vector<BytecodeInstr>    code;
+    // Index in `code` of the first instruction of each basic block
+    ::std::vector<uint32_t> block_starts;
+    ::std::vector<BytecodeSlot> slots;
+    ::std::vector<Value>    consts;
+    ::std::vector<const Function*>  callees;
+    // Number of instructions that need the MIR interpreter
+    size_t  n_generic = 0;
+
+    static BytecodeFunction compile(const GlobalState& global, const Function& fcn);
+
+    size_t get_pc(unsigned bb_idx, unsigned stmt_idx) const {
+        return block_starts[bb_idx] + stmt_idx;
+    }
+};
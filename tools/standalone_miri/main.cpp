@@ -75,12 +75,10 @@ int main(int argc, const char* argv[])
 
     // Create argc/argv based on input arguments
     auto argv_alloc = Allocation::new_alloc((1 + opts.args.size()) * POINTER_SIZE, "argv");
-    argv_alloc->write_usize(0 * POINTER_SIZE, Allocation::PTR_BASE);
-    argv_alloc->relocations.push_back({ 0 * POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv0", opts.infile.c_str(), opts.infile.size() + 1)) });
+    argv_alloc->write_ptr(0 * POINTER_SIZE, Allocation::PTR_BASE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv0", opts.infile.c_str(), opts.infile.size() + 1)));
     for(size_t i = 0; i < opts.args.size(); i ++)
     {
-        argv_alloc->write_usize((1 + i) * POINTER_SIZE, Allocation::PTR_BASE);
-        argv_alloc->relocations.push_back({ (1 + i) * POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv", opts.args[i], ::std::strlen(opts.args[i]) + 1)) });
+        argv_alloc->write_ptr((1 + i) * POINTER_SIZE, Allocation::PTR_BASE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv", opts.args[i], ::std::strlen(opts.args[i]) + 1)));
     }
     LOG_DEBUG("argv_alloc = " << *argv_alloc);
 
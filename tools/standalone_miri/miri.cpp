@@ -636,6 +636,61 @@ struct MirHelpers
         return param_to_value(p, ty);
     }
 
+    // Storage for a `BytecodeSlot` (either a stack slot or an allocation)
+    struct Place
+    {
+        Value*  value;
+        Allocation* alloc;
+        size_t  ofs;
+
+        ValueCommonWrite& storage() { return value ? static_cast<ValueCommonWrite&>(*value) : *alloc; }
+        Value read_value(size_t size) const { return value ? value->read_value(ofs, size) : alloc->read_value(ofs, size); }
+        void write_value(Value v) { if(value) value->write_value(ofs, ::std::move(v)); else alloc->write_value(ofs, ::std::move(v)); }
+    };
+    /// Resolve a slot, returns false if the slot can't be accessed directly (the pointer isn't into an allocation)
+    bool get_place(const BytecodeSlot& s, Place& out)
+    {
+        Value*  root;
+        switch(s.root)
+        {
+        case BytecodeSlot::Root::Return:    root = &this->frame.ret;    break;
+        case BytecodeSlot::Root::Local:     root = &this->frame.locals[s.idx];  break;
+        case BytecodeSlot::Root::Argument:  root = &this->frame.args.at(s.idx); break;
+        default:    throw "";
+        }
+        if( !s.deref )
+        {
+            out = Place { root, nullptr, s.ofs };
+            return true;
+        }
+        auto reloc = root->get_relocation(s.ofs);
+        if( !reloc.is_alloc() )
+            return false;
+        auto ptr = root->read_usize(s.ofs);
+        if( ptr < Allocation::PTR_BASE )
+            return false;
+        out = Place { nullptr, &reloc.alloc(), ptr - Allocation::PTR_BASE + s.deref_ofs };
+        return true;
+    }
+    /// Read a BinOp operand (zero-extended), returns false if it can't be handled by the fast path (has a relocation)
+    bool read_operand(const BytecodeFunction& code, uint32_t idx, size_t size, uint64_t& out)
+    {
+        out = 0;
+        if( idx & BytecodeFunction::OPERAND_CONST )
+        {
+            code.consts[idx & ~BytecodeFunction::OPERAND_CONST].read_bytes(0, &out, size);
+            return true;
+        }
+        Place   p;
+        if( !get_place(code.slots[idx], p) )
+            return false;
+        const auto& storage = p.storage();
+        if( storage.get_relocation(p.ofs) )
+            return false;
+        storage.read_bytes(p.ofs, &out, size);
+        return true;
+    }
+
     ValueRef get_value_ref_param(const ::MIR::Param& p, Value& tmp, ::HIR::TypeRef& ty)
     {
         switch(p.tag())
@@ -744,6 +799,106 @@ GlobalState::GlobalState(const ModuleTree& modtree):
     m_fcn_overrides.insert(::std::make_pair( make_simplepath("std"      , {"sys", "imp", "stack_overflow", "imp", "init"}), cb_nop));
     m_fcn_overrides.insert(::std::make_pair( make_simplepath("std#0_0_0", {"sys", "imp", "stack_overflow", "imp", "init"}), cb_nop));
 }
+const BytecodeFunction& GlobalState::get_bytecode(const Function& fcn)
+{
+    auto it = m_bytecode.find(&fcn);
+    if( it == m_bytecode.end() )
+    {
+        ::std::unique_ptr<BytecodeFunction> code { new BytecodeFunction(BytecodeFunction::compile(*this, fcn)) };
+        it = m_bytecode.insert(::std::make_pair(&fcn, ::std::move(code))).first;
+    }
+    return *it->second;
+}
+
+namespace {
+    uint64_t sign_extend(uint64_t v, size_t size)
+    {
+        if( size >= 8 )
+            return v;
+        unsigned shift = static_cast<unsigned>(64 - size * 8);
+        return static_cast<uint64_t>(static_cast<int64_t>(v << shift) >> shift);
+    }
+    bool is_signed(RawType ty)
+    {
+        switch(ty)
+        {
+        case RawType::I8:   case RawType::I16:  case RawType::I32:  case RawType::I64:  case RawType::ISize:
+            return true;
+        default:
+            return false;
+        }
+    }
+    /// Evaluate a bytecode BinOp on zero-extended operands (see `Lowerer::is_fast_binop` for the supported types)
+    /// - Returns false if the operation needs the checks/diagnostics of the general implementation
+    bool bytecode_binop(::MIR::eBinOp op, RawType ty_l, RawType ty_r, size_t size_l, size_t size_r, uint64_t l, uint64_t r, uint64_t& out)
+    {
+        const uint64_t  mask = size_l >= 8 ? ~uint64_t(0) : (uint64_t(1) << (size_l * 8)) - 1;
+        const bool  sgn = is_signed(ty_l);
+        switch(op)
+        {
+        case ::MIR::eBinOp::ADD:    out = (l + r) & mask;   return true;
+        case ::MIR::eBinOp::SUB:    out = (l - r) & mask;   return true;
+        case ::MIR::eBinOp::MUL:    out = (l * r) & mask;   return true;
+        case ::MIR::eBinOp::DIV:
+        case ::MIR::eBinOp::MOD:
+            if( r == 0 )
+                return false;
+            if( sgn )
+            {
+                auto sl = static_cast<int64_t>(sign_extend(l, size_l));
+                auto sr = static_cast<int64_t>(sign_extend(r, size_l));
+                // `MIN / -1` overflows
+                if( sr == -1 )
+                    return false;
+                out = static_cast<uint64_t>(op == ::MIR::eBinOp::DIV ? sl / sr : sl % sr) & mask;
+            }
+            else
+            {
+                out = (op == ::MIR::eBinOp::DIV ? l / r : l % r);
+            }
+            return true;
+        case ::MIR::eBinOp::BIT_AND:    out = l & r;    return true;
+        case ::MIR::eBinOp::BIT_OR:     out = l | r;    return true;
+        case ::MIR::eBinOp::BIT_XOR:    out = l ^ r;    return true;
+        case ::MIR::eBinOp::BIT_SHL:
+        case ::MIR::eBinOp::BIT_SHR: {
+            if( is_signed(ty_r) && static_cast<int64_t>(sign_extend(r, size_r)) < 0 )
+                return false;
+            if( r >= size_l * 8 )
+                return false;
+            // NOTE: Shifts are unsigned (matches the general implementation)
+            out = (op == ::MIR::eBinOp::BIT_SHL ? l << r : l >> r) & mask;
+            return true;
+            }
+        case ::MIR::eBinOp::EQ: out = (l == r); return true;
+        case ::MIR::eBinOp::NE: out = (l != r); return true;
+        case ::MIR::eBinOp::GT:
+        case ::MIR::eBinOp::GE:
+        case ::MIR::eBinOp::LT:
+        case ::MIR::eBinOp::LE: {
+            int res;
+            if( sgn ) {
+                auto sl = static_cast<int64_t>(sign_extend(l, size_l));
+                auto sr = static_cast<int64_t>(sign_extend(r, size_l));
+                res = sl < sr ? -1 : (sl > sr ? 1 : 0);
+            }
+            else {
+                res = l < r ? -1 : (l > r ? 1 : 0);
+            }
+            switch(op)
+            {
+            case ::MIR::eBinOp::GT: out = (res > 0);    break;
+            case ::MIR::eBinOp::GE: out = (res >= 0);   break;
+            case ::MIR::eBinOp::LT: out = (res < 0);    break;
+            default:                out = (res <= 0);   break;
+            }
+            return true;
+            }
+        default:
+            return false;
+        }
+    }
+}
 
 // ====================================================================
 //
@@ -783,9 +938,6 @@ bool InterpreterThread::step_one(Value& out_thread_result)
     assert( !this->m_stack.empty() );
     assert( !this->m_stack.back().cb );
     auto& cur_frame = this->m_stack.back();
-    auto instr_idx = this->m_instruction_count++;
-    TRACE_FUNCTION_R("#" << instr_idx << " " << cur_frame.fcn->my_path << " BB" << cur_frame.bb_idx << "/" << cur_frame.stmt_idx, "#" << instr_idx);
-    const auto& bb = cur_frame.fcn->m_mir.blocks.at( cur_frame.bb_idx );
 
     const size_t    MAX_STACK_DEPTH = 90;
     if( this->m_stack.size() > MAX_STACK_DEPTH )
@@ -793,6 +945,108 @@ bool InterpreterThread::step_one(Value& out_thread_result)
         LOG_ERROR("Maximum stack depth of " << MAX_STACK_DEPTH << " exceeded");
     }
 
+    if( !cur_frame.code )
+        cur_frame.code = &m_global.get_bytecode(*cur_frame.fcn);
+    const auto& code = *cur_frame.code;
+
+    MirHelpers  state { *this, cur_frame };
+
+    // Run pre-decoded instructions until a call/return or something that needs the MIR interpreter
+    // - These are not logged individually (the MIR interpreter logs every statement)
+    size_t  pc = code.get_pc(cur_frame.bb_idx, cur_frame.stmt_idx);
+    for(;;)
+    {
+        const auto& instr = code.code[pc];
+        // Keep the frame position current for error reporting
+        cur_frame.bb_idx = instr.bb_idx;
+        cur_frame.stmt_idx = instr.stmt_idx;
+
+        MirHelpers::Place   dst;
+        switch(instr.op)
+        {
+        case BytecodeOp::Copy: {
+            MirHelpers::Place   src;
+            if( !state.get_place(code.slots[instr.b], src) )
+                break;
+            auto v = src.read_value(code.slots[instr.b].size);
+            if( !state.get_place(code.slots[instr.a], dst) )
+                break;
+            dst.write_value(::std::move(v));
+            this->m_instruction_count ++;
+            pc ++;
+            continue; }
+        case BytecodeOp::Const:
+            if( !state.get_place(code.slots[instr.a], dst) )
+                break;
+            dst.write_value(code.consts[instr.b]);
+            this->m_instruction_count ++;
+            pc ++;
+            continue;
+        case BytecodeOp::BinOp: {
+            auto ty_l = static_cast<RawType>(instr.prim_l);
+            auto ty_r = static_cast<RawType>(instr.prim_r);
+            size_t  size_l = ::HIR::TypeRef(ty_l).get_size();
+            size_t  size_r = ::HIR::TypeRef(ty_r).get_size();
+            uint64_t    l, r, res;
+            if( !state.read_operand(code, instr.b, size_l, l) || !state.read_operand(code, instr.c, size_r, r) )
+                break;
+            if( !bytecode_binop(static_cast<::MIR::eBinOp>(instr.sub_op), ty_l, ty_r, size_l, size_r, l, r, res) )
+                break;
+            if( !state.get_place(code.slots[instr.a], dst) )
+                break;
+            dst.storage().write_bytes(dst.ofs, &res, code.slots[instr.a].size);
+            this->m_instruction_count ++;
+            pc ++;
+            continue; }
+        case BytecodeOp::SetDropFlag:
+            cur_frame.drop_flags.at(instr.a) = (instr.c == ~0u ? false : cur_frame.drop_flags.at(instr.c)) != (instr.b != 0);
+            this->m_instruction_count ++;
+            pc ++;
+            continue;
+        case BytecodeOp::Nop:
+            this->m_instruction_count ++;
+            pc ++;
+            continue;
+        case BytecodeOp::Goto:
+            this->m_instruction_count ++;
+            pc = instr.a;
+            continue;
+        case BytecodeOp::If: {
+            if( !state.get_place(code.slots[instr.a], dst) )
+                break;
+            uint8_t v = dst.storage().read_u8(dst.ofs);
+            if( v > 1 )
+                break;
+            this->m_instruction_count ++;
+            pc = v ? instr.b : instr.c;
+            continue; }
+        case BytecodeOp::Return:
+            this->m_instruction_count ++;
+            LOG_DEBUG("RETURN " << cur_frame.ret);
+            return this->pop_stack(out_thread_result);
+        case BytecodeOp::Call: {
+            // The frame stays on the Call terminator, `pop_stack` writes the result and moves on
+            const auto& te = cur_frame.fcn->m_mir.blocks[instr.bb_idx].terminator.as_Call();
+            ::std::vector<Value>    sub_args; sub_args.reserve(te.args.size());
+            for(const auto& a : te.args)
+                sub_args.push_back( state.param_to_value(a) );
+            this->m_instruction_count ++;
+            LOG_DEBUG("Call " << te.fcn.as_Path());
+            this->m_stack.push_back(StackFrame(*code.callees[instr.a], ::std::move(sub_args)));
+            return false; }
+        case BytecodeOp::Generic:
+            break;
+        }
+        return this->step_one_mir(out_thread_result);
+    }
+}
+bool InterpreterThread::step_one_mir(Value& out_thread_result)
+{
+    auto& cur_frame = this->m_stack.back();
+    auto instr_idx = this->m_instruction_count++;
+    TRACE_FUNCTION_R("#" << instr_idx << " " << cur_frame.fcn->my_path << " BB" << cur_frame.bb_idx << "/" << cur_frame.stmt_idx, "#" << instr_idx);
+    const auto& bb = cur_frame.fcn->m_mir.blocks.at( cur_frame.bb_idx );
+
     MirHelpers  state { *this, cur_frame };
 
     if( cur_frame.stmt_idx < bb.statements.size() )
@@ -2019,6 +2273,7 @@ unsigned InterpreterThread::StackFrame::s_next_frame_index = 0;
 InterpreterThread::StackFrame::StackFrame(const Function& fcn, ::std::vector<Value> args):
     frame_index(s_next_frame_index++),
     fcn(&fcn),
+    code(nullptr),
     ret( fcn.ret_ty == RawType::Unreachable ? Value() : Value(fcn.ret_ty) ),
     args( ::std::move(args) ),
     locals( ),
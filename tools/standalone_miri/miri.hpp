@@ -8,6 +8,8 @@
 #pragma once
 #include "module_tree.hpp"
 #include "value.hpp"
+#include "bytecode.hpp"
+#include <memory>
 
 struct ThreadState
 {
@@ -48,7 +50,12 @@ struct GlobalState
 
     std::map<RcString, override_handler_t*>  m_fcn_overrides;
 
+    // Pre-decoded function bodies, populated on first call
+    std::map<const Function*, std::unique_ptr<BytecodeFunction>>    m_bytecode;
+
     GlobalState(const ModuleTree& modtree);
+
+    const BytecodeFunction& get_bytecode(const Function& fcn);
 };
 
 class InterpreterThread
@@ -62,6 +69,7 @@ class InterpreterThread
 
         ::std::function<bool(Value&,Value)> cb;
         const Function* fcn;
+        const BytecodeFunction* code;
         Value ret;
         ::std::vector<Value>    args;
         ::std::vector<Value>    locals;
@@ -97,6 +105,8 @@ public:
     bool step_one(Value& out_thread_result);
 
 private:
+    // Execute the current MIR statement/terminator of the top frame (for anything the bytecode can't handle)
+    bool step_one_mir(Value& out_thread_result);
     bool pop_stack(Value& out_thread_result);
 
     // Returns true if the call was resolved instantly
@@ -34,23 +34,82 @@ namespace {
     bool get_bit(const uint8_t* p, size_t i) {
         return (p[i/8] & (1 << (i%8))) != 0;
     }
+    // NOTE: The bitmap helpers below handle the unaligned head/tail bit-by-bit and the rest a byte or word at a time
+
+    /// Check that all bits in `ofs .. ofs+len` are set
+    bool all_bits_set(const uint8_t* p, size_t ofs, size_t len)
+    {
+        for( ; len > 0 && ofs % 8 != 0; ofs ++, len --)
+        {
+            if( !get_bit(p, ofs) )
+                return false;
+        }
+        const uint8_t* b = p + ofs / 8;
+        size_t  n_bytes = len / 8;
+        for( ; n_bytes >= 8; n_bytes -= 8, b += 8)
+        {
+            uint64_t    w;
+            ::std::memcpy(&w, b, 8);
+            if( w != ~uint64_t(0) )
+                return false;
+        }
+        for( ; n_bytes > 0; n_bytes --, b ++)
+        {
+            if( *b != 0xFF )
+                return false;
+        }
+        if( len % 8 != 0 )
+        {
+            uint8_t m = static_cast<uint8_t>((1 << (len % 8)) - 1);
+            if( (*b & m) != m )
+                return false;
+        }
+        return true;
+    }
+    /// Set all bits in `ofs .. ofs+len`
+    void set_bits(uint8_t* p, size_t ofs, size_t len)
+    {
+        for( ; len > 0 && ofs % 8 != 0; ofs ++, len --)
+        {
+            set_bit(p, ofs, true);
+        }
+        ::std::memset(p + ofs / 8, 0xFF, len / 8);
+        if( len % 8 != 0 )
+        {
+            p[(ofs + len) / 8] |= static_cast<uint8_t>((1 << (len % 8)) - 1);
+        }
+    }
     void copy_bits(uint8_t* dst, size_t dst_ofs, const uint8_t* src, size_t src_ofs,  size_t len)
     {
-        // Even number of bytes, fast copy
-        if( dst_ofs % 8 == 0 && src_ofs % 8 == 0 && len % 8 == 0 )
+        // Align the destination to a byte boundary
+        for( ; len > 0 && dst_ofs % 8 != 0; dst_ofs ++, src_ofs ++, len --)
         {
-            for(size_t i = 0; i < len/8; i ++)
-            {
-                dst[dst_ofs/8 + i] = src[src_ofs/8 + i];
-            }
+            set_bit( dst, dst_ofs, get_bit(src, src_ofs) );
+        }
+        // Whole destination bytes (combining two source bytes if the source isn't aligned)
+        size_t  n_bytes = len / 8;
+        uint8_t* d = dst + dst_ofs / 8;
+        const uint8_t* s = src + src_ofs / 8;
+        unsigned shift = src_ofs % 8;
+        if( shift == 0 )
+        {
+            ::std::memmove(d, s, n_bytes);
         }
         else
         {
-            for(size_t i = 0; i < len; i ++)
+            for(size_t i = 0; i < n_bytes; i ++)
             {
-                set_bit( dst, dst_ofs+i, get_bit(src, src_ofs+i) );
+                d[i] = static_cast<uint8_t>( (s[i] >> shift) | (s[i+1] << (8 - shift)) );
             }
         }
+        dst_ofs += n_bytes * 8;
+        src_ofs += n_bytes * 8;
+        len -= n_bytes * 8;
+        // Tail
+        for( ; len > 0; dst_ofs ++, src_ofs ++, len --)
+        {
+            set_bit( dst, dst_ofs, get_bit(src, src_ofs) );
+        }
     }
 };
 
@@ -408,27 +467,29 @@ void Allocation::resize(size_t new_size)
     this->m_mask.resize( (new_size + 8-1) / 8 );
 }
 
+RelocationPtr Allocation::get_relocation(size_t ofs) const
+{
+    auto it = this->relocations.find(ofs);
+    if( it != this->relocations.end() )
+        return it->second;
+    return RelocationPtr();
+}
+
 void Allocation::check_bytes_valid(size_t ofs, size_t size) const
 {
     if( !in_bounds(ofs, size, this->size()) ) {
         LOG_FATAL("Out of range - " << ofs << "+" << size << " > " << this->size());
     }
-    for(size_t i = ofs; i < ofs + size; i++)
+    if( !all_bits_set(this->m_mask.data(), ofs, size) )
     {
-        if( !(this->m_mask[i/8] & (1 << (i%8))) )
-        {
-            LOG_ERROR("Invalid bytes in value - " << ofs << "+" << size << " - " << *this);
-            throw "ERROR";
-        }
+        LOG_ERROR("Invalid bytes in value - " << ofs << "+" << size << " - " << *this);
+        throw "ERROR";
     }
 }
 void Allocation::mark_bytes_valid(size_t ofs, size_t size)
 {
     assert( ofs+size <= this->m_mask.size() * 8 );
-    for(size_t i = ofs; i < ofs + size; i++)
-    {
-        this->m_mask[i/8] |= (1 << (i%8));
-    }
+    set_bits(this->m_mask.data(), ofs, size);
 }
 Value Allocation::read_value(size_t ofs, size_t size) const
 {
@@ -436,30 +497,21 @@ Value Allocation::read_value(size_t ofs, size_t size) const
     //TRACE_FUNCTION_R("Allocation::read_value " << this << " " << ofs << "+" << size, *this << " | " << size << "=" << rv);
     if( this->is_freed )
         LOG_ERROR("Use of freed memory " << this);
-    LOG_DEBUG(*this);
+    LOG_DEBUG(this << " " << ofs << "+" << size);
     LOG_ASSERT( in_bounds(ofs, size, this->size()), "Read out of bounds (" << ofs << "+" << size << " > " << this->size() << ")" );
 
+    auto relocs_begin = this->relocations.lower_bound(ofs);
+    auto relocs_end = this->relocations.lower_bound(ofs + size);
+
     // Determine if this can become an inline allocation.
-    bool has_reloc = false;
-    for(const auto& r : this->relocations)
-    {
-        if( ofs <= r.slot_ofs && r.slot_ofs < ofs + size )
-        {
-            // NOTE: A relocation at offset zero is allowed
-            if( r.slot_ofs == ofs )
-                continue ;
-            has_reloc = true;
-        }
-    }
+    // NOTE: A relocation at offset zero is allowed
+    bool has_reloc = relocs_begin != relocs_end && !(::std::next(relocs_begin) == relocs_end && relocs_begin->first == ofs);
     rv = Value::with_size(size, has_reloc);
     rv.write_bytes(0, this->data_ptr() + ofs, size);
 
-    for(const auto& r : this->relocations)
+    for(auto it = relocs_begin; it != relocs_end; ++it)
     {
-        if( ofs <= r.slot_ofs && r.slot_ofs < ofs + size )
-        {
-            rv.set_reloc(r.slot_ofs - ofs, /*r.size*/POINTER_SIZE, r.backing_alloc);
-        }
+        rv.set_reloc(it->first - ofs, /*r.size*/POINTER_SIZE, it->second);
     }
     // Copy the mask bits
     copy_bits(rv.get_mask_mut(), 0, m_mask.data(), ofs, size);
@@ -486,7 +538,7 @@ void Allocation::read_bytes(size_t ofs, void* dst, size_t count) const
 }
 void Allocation::write_value(size_t ofs, Value v)
 {
-    TRACE_FUNCTION_R("Allocation::write_value " << this << " " << ofs << "+" << v.size() << " " << v, *this);
+    TRACE_FUNCTION_R("Allocation::write_value " << this << " " << ofs << "+" << v.size() << " " << v, "");
     if( this->is_freed )
         LOG_ERROR("Use of freed memory " << this);
     //if( this->is_read_only )
@@ -500,7 +552,7 @@ void Allocation::write_value(size_t ofs, Value v)
         // Take a copy of the source mask
         auto s_mask = src_alloc.m_mask;
         // Save relocations first, because `Foo = Foo` is valid?
-        ::std::vector<Relocation>   new_relocs = src_alloc.relocations;
+        auto new_relocs = src_alloc.relocations;
         // - write_bytes removes any relocations in this region.
         write_bytes(ofs, src_alloc.data_ptr(), v_size);
 
@@ -509,11 +561,12 @@ void Allocation::write_value(size_t ofs, Value v)
         if( !new_relocs.empty() )
         {
             // 2. Move the new relocations into this allocation
+            // - The region was just cleared and the source is sorted, so each goes after the previous one
+            auto hint = this->relocations.lower_bound(ofs);
             for(auto& r : new_relocs)
             {
-                //LOG_TRACE("Insert " << r.backing_alloc);
-                r.slot_ofs += ofs;
-                this->relocations.push_back( ::std::move(r) );
+                //LOG_TRACE("Insert " << r.second);
+                hint = ::std::next(this->relocations.emplace_hint(hint, r.first + ofs, ::std::move(r.second)));
             }
         }
 
@@ -549,18 +602,9 @@ void Allocation::write_bytes(size_t ofs, const void* src, size_t count)
 
 
     // - Remove any relocations already within this region
-    auto& this_relocs = this->relocations;
-    for(auto it = this_relocs.begin(); it != this_relocs.end(); )
+    if( !this->relocations.empty() )
     {
-        if( ofs <= it->slot_ofs && it->slot_ofs < ofs + count)
-        {
-            //LOG_TRACE("Delete " << it->backing_alloc);
-            it = this_relocs.erase(it);
-        }
-        else 
-        {
-            ++it;
-        }
+        this->relocations.erase(this->relocations.lower_bound(ofs), this->relocations.lower_bound(ofs + count));
     }
 
     ::std::memcpy(this->data_ptr() + ofs, src, count);
@@ -576,21 +620,12 @@ void Allocation::set_reloc(size_t ofs, size_t len, RelocationPtr reloc)
 {
     LOG_ASSERT(ofs % POINTER_SIZE == 0, "Allocation::set_reloc(" << ofs << ", " << len << ", " << reloc << ")");
     LOG_ASSERT(len == POINTER_SIZE, "Allocation::set_reloc(" << ofs << ", " << len << ", " << reloc << ")");
-    // Delete any existing relocation at this position
-    for(auto it = this->relocations.begin(); it != this->relocations.end();)
-    {
-        if( ofs <= it->slot_ofs && it->slot_ofs < ofs + len )
-        {
-            // Slot starts in this updated region
-            // - TODO: Split in half?
-            it = this->relocations.erase(it);
-            continue ;
-        }
-        // TODO: What if the slot ends in the new region?
-        // What if the new region is in the middle of the slot
-        ++ it;
-    }
-    this->relocations.push_back(Relocation { ofs, /*len,*/ ::std::move(reloc) });
+    // Delete any existing relocation at this position (slots that start in this updated region)
+    // - TODO: Split in half?
+    // - TODO: What if the slot ends in the new region?
+    // What if the new region is in the middle of the slot
+    auto it = this->relocations.erase(this->relocations.lower_bound(ofs), this->relocations.lower_bound(ofs + len));
+    this->relocations.emplace_hint(it, ofs, ::std::move(reloc));
 }
 ::std::ostream& operator<<(::std::ostream& os, const Allocation& x)
 {
@@ -615,9 +650,9 @@ void Allocation::set_reloc(size_t ofs, size_t len, RelocationPtr reloc)
     os << " {";
     for(const auto& r : x.relocations)
     {
-        if( 0 <= r.slot_ofs && r.slot_ofs < x.size() )
+        if( 0 <= r.first && r.first < x.size() )
         {
-            os << " @" << r.slot_ofs << "=" << r.backing_alloc;
+            os << " @" << r.first << "=" << r.second;
         }
     }
     os << " }";
@@ -735,11 +770,14 @@ void Value::check_bytes_valid(size_t ofs, size_t size) const
         throw "ERROR";
     }
     const auto* mask = this->get_mask();
-    for(size_t i = ofs; i < ofs + size; i++)
+    if( !all_bits_set(mask, ofs, size) )
     {
-        if( !get_bit(mask, i) )
+        for(size_t i = ofs; i < ofs + size; i++)
         {
-            LOG_ERROR("Accessing invalid bytes in value, offset " << i << " of " << *this);
+            if( !get_bit(mask, i) )
+            {
+                LOG_ERROR("Accessing invalid bytes in value, offset " << i << " of " << *this);
+            }
         }
     }
 }
@@ -751,10 +789,7 @@ void Value::mark_bytes_valid(size_t ofs, size_t size)
     }
     else
     {
-        for(size_t i = ofs; i < ofs+size; i++)
-        {
-            m_inner.direct.mask[i/8] |= (1 << i%8);
-        }
+        set_bits(m_inner.direct.mask, ofs, size);
     }
 }
 
@@ -834,14 +869,17 @@ void Value::write_value(size_t ofs, Value v)
         // - Copy mask
         copy_bits(this->get_mask_mut(), ofs,  v.get_mask(), 0,  v.size());
 
-        // TODO: Faster way of knowing where there are relocations
-        for(size_t i = 0; i < v.size(); i ++)
+        if( v.m_inner.is_alloc )
         {
-            if( auto r = v.get_relocation(i) )
+            for(const auto& r : v.m_inner.alloc.alloc->relocations)
             {
-                this->set_reloc(ofs + i, POINTER_SIZE, r);
+                this->set_reloc(ofs + r.first, POINTER_SIZE, r.second);
             }
         }
+        else if( v.m_inner.direct.reloc_0 )
+        {
+            this->set_reloc(ofs, POINTER_SIZE, ::std::move(v.m_inner.direct.reloc_0));
+        }
     }
 }
 void Value::write_ptr(size_t ofs, size_t ptr_ofs, RelocationPtr reloc)
@@ -900,12 +938,9 @@ extern ::std::ostream& operator<<(::std::ostream& os, const ValueRef& v)
             os.setf(flags);
 
             os << " {";
-            for(const auto& r : alloc.relocations)
+            for(auto it = alloc.relocations.lower_bound(v.m_offset); it != alloc.relocations.lower_bound(v.m_offset + v.m_size); ++it)
             {
-                if( v.m_offset <= r.slot_ofs && r.slot_ofs < v.m_offset + v.m_size )
-                {
-                    os << " @" << (r.slot_ofs - v.m_offset) << "=" << r.backing_alloc;
-                }
+                os << " @" << (it->first - v.m_offset) << "=" << it->second;
             }
             os << " }";
             } break;
@@ -953,12 +988,9 @@ extern ::std::ostream& operator<<(::std::ostream& os, const ValueRef& v)
         os.setf(flags);
 
         os << " {";
-        for(const auto& r : alloc.relocations)
+        for(auto it = alloc.relocations.lower_bound(v.m_offset); it != alloc.relocations.lower_bound(v.m_offset + v.m_size); ++it)
         {
-            if( v.m_offset <= r.slot_ofs && r.slot_ofs < v.m_offset + v.m_size )
-            {
-                os << " @" << (r.slot_ofs - v.m_offset) << "=" << r.backing_alloc;
-            }
+            os << " @" << (it->first - v.m_offset) << "=" << it->second;
         }
         os << " }";
     }
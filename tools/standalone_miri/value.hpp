@@ -8,6 +8,7 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <memory>
 #include <cstdint>
 #include <cstring>	// memcpy
@@ -178,14 +179,6 @@ private:
         return reinterpret_cast<void*>( reinterpret_cast<uintptr_t>(m_ptr) & ~3 );
     }
 };
-struct Relocation
-{
-    // Offset within parent allocation where this relocation is performed.
-    // TODO: Size?
-    size_t  slot_ofs;
-    RelocationPtr   backing_alloc;
-};
-
 // TODO: Split write and read
 struct ValueCommonRead
 {
@@ -276,8 +269,11 @@ class Allocation:
 
     ::std::vector<uint64_t> m_data;
 public:
+    // Validity bitmap, one bit per byte
     ::std::vector<uint8_t> m_mask;
-    ::std::vector<Relocation>   relocations;
+    // Relocations, keyed by the offset within this allocation where the pointer is stored
+    // TODO: Size?
+    ::std::map<size_t, RelocationPtr>   relocations;
 public:
     virtual ~Allocation() {}
     static AllocationHandle new_alloc(size_t size, ::std::string tag);
@@ -290,13 +286,7 @@ public:
     size_t size() const { return m_size; }
     const ::std::string& tag() const { return m_tag; }
 
-    RelocationPtr get_relocation(size_t ofs) const override {
-        for(const auto& r : relocations) {
-            if(r.slot_ofs == ofs)
-                return r.backing_alloc;
-        }
-        return RelocationPtr();
-    }
+    RelocationPtr get_relocation(size_t ofs) const override;
     void mark_as_freed() {
         is_freed = true;
         relocations.clear();
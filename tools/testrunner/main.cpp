@@ -14,6 +14,13 @@
 #include <vector>
 #include <fstream>
 #include <cctype>   // std::isblank
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <iomanip>
 #include "../common/debug.h"
 #include "../common/path.h"
 #ifdef _WIN32
@@ -27,6 +34,8 @@
 # include <spawn.h>
 # include <fcntl.h> // O_*
 # include <sys/wait.h>  // waitpid
+# include <signal.h>    // kill
+# include <errno.h>
 # define MRUSTC_PATH    "./bin/mrustc"
 #endif
 #include <algorithm>
@@ -45,6 +54,12 @@ struct Options
     const char* exceptions_file = nullptr;
     bool fail_fast = false;
 
+    // Number of tests to build/run concurrently
+    unsigned num_jobs = 1;
+    // Seconds before a test executable/compiler invocation is killed (zero for no limit)
+    unsigned run_timeout = 10;
+    unsigned compile_timeout = 0;
+
     int parse(int argc, const char* argv[]);
 
     void usage_short() const;
@@ -150,18 +165,33 @@ bool run_compiler(const Options& opts, const ::helpers::path& source_file, const
     for(const auto& s : extra_flags)
         args.push_back(s.c_str());
 
-    return run_executable(MRUSTC_PATH, args, logfile, 0);
+    return run_executable(MRUSTC_PATH, args, logfile, opts.compile_timeout);
 }
 
-static bool gTimeout = false;
-static bool gInterrupted = false;
-void sigalrm_handler(int) {
-    gTimeout = true;
-}
+static ::std::atomic<bool> gInterrupted { false };
 void sigint_handler(int) {
     gInterrupted = true;
 }
 
+enum class TestResult
+{
+    NotRun, // Not selected or ignored
+    Skip,   // Listed in the exceptions file
+    Ok,
+    CompileFail,
+    RunFail,
+};
+struct TestTiming
+{
+    TestResult  result = TestResult::NotRun;
+    double  compile_s = 0;
+    double  run_s = 0;
+};
+static double secs_since(::std::chrono::steady_clock::time_point start)
+{
+    return ::std::chrono::duration<double>(::std::chrono::steady_clock::now() - start).count();
+}
+
 int main(int argc, const char* argv[])
 {
     Options opts;
@@ -172,12 +202,7 @@ int main(int argc, const char* argv[])
 
 #ifdef _WIN32
 #else
-    {
-        struct sigaction    sa = {0};
-        sa.sa_handler = sigalrm_handler;
-        sigaction(SIGALRM, &sa, NULL);
-        signal(SIGINT, sigint_handler);
-    }
+    signal(SIGINT, sigint_handler);
 #endif
 
     ::std::vector<::std::string>    skip_list;
@@ -332,34 +357,27 @@ int main(int argc, const char* argv[])
         const bool SKIP_PASS = (getenv("TESTRUNNER_SKIPPASS") != nullptr);
         const bool NO_COMPILER_DEP = (getenv("TESTRUNNER_NOCOMPILERDEP") != nullptr);
         const auto compiler_ts = Timestamp::for_file(MRUSTC_PATH);
-        unsigned n_skip = 0;
-        unsigned n_cfail = 0;
-        unsigned n_fail = 0;
-        unsigned n_ok = 0;
-        for(const auto& test : tests)
-        {
-            if( gInterrupted ) {
-                DEBUG(">> Interrupted");
-                return 1;
-            }
+
+        // Build and run a single test, recording how long each stage took
+        // - Called concurrently from the worker threads, so only touches per-test state
+        auto run_test = [&](const TestDesc& test, TestTiming& timing)->TestResult {
             if( !opts.test_list.empty() && ::std::find(opts.test_list.begin(), opts.test_list.end(), test.m_name) == opts.test_list.end() )
             {
                 if( opts.debug_level > 0 )
                     DEBUG(">> NOT SELECTED");
-                continue ;
+                return TestResult::NotRun;
             }
             if( test.ignore )
             {
                 if( opts.debug_level > 0 )
                     DEBUG(">> IGNORE " << test.m_name);
-                continue ;
+                return TestResult::NotRun;
             }
             if( ::std::find(skip_list.begin(), skip_list.end(), test.m_name) != skip_list.end() )
             {
                 if( opts.debug_level > 0 )
                     DEBUG(">> SKIP " << test.m_name);
-                n_skip ++;
-                continue ;
+                return TestResult::Skip;
             }
 
             //DEBUG(">> " << test.m_name);
@@ -382,7 +400,7 @@ int main(int argc, const char* argv[])
             }
             if( test_exe_ts == Timestamp::infinite_past() || (!NO_COMPILER_DEP && !SKIP_PASS && test_exe_ts < compiler_ts) )
             {
-                bool pre_build_failed = false;
+                auto compile_start = ::std::chrono::steady_clock::now();
                 for(const auto& file : test.m_pre_build)
                 {
 #ifdef _WIN32
@@ -394,18 +412,10 @@ int main(int argc, const char* argv[])
                     if( !run_compiler(opts, infile, depdir, {}, depdir, true) )
                     {
                         DEBUG("COMPILE FAIL " << infile << " (dep of " << test.m_name << ")");
-                        n_cfail ++;
-                        pre_build_failed = true;
-                        break;
+                        timing.compile_s = secs_since(compile_start);
+                        return TestResult::CompileFail;
                     }
                 }
-                if( pre_build_failed )
-                {
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
-                }
 
                 // If there's no pre-build files (dependencies), clear the dependency path (cleaner output)
                 if( test.m_pre_build.empty() )
@@ -414,14 +424,12 @@ int main(int argc, const char* argv[])
                 }
 
                 auto compile_logfile = test_exe + "-build.log";
-                if( !run_compiler(opts, test.m_path, test_exe, test.m_extra_flags, depdir) )
+                bool compiled = run_compiler(opts, test.m_path, test_exe, test.m_extra_flags, depdir);
+                timing.compile_s = secs_since(compile_start);
+                if( !compiled )
                 {
                     DEBUG("COMPILE FAIL " << test.m_name << ", log in " << compile_logfile);
-                    n_cfail ++;
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
+                    return TestResult::CompileFail;
                 }
                 test_exe_ts = Timestamp::for_file(test_exe);
             }
@@ -435,7 +443,10 @@ int main(int argc, const char* argv[])
             else if( test_output_ts < test_exe_ts )
             {
                 auto run_out_file_tmp = test_output + ".tmp";
-                if( !run_executable(test_exe, { test_exe.str().c_str() }, run_out_file_tmp, 10) )
+                auto run_start = ::std::chrono::steady_clock::now();
+                bool passed = run_executable(test_exe, { test_exe.str().c_str() }, run_out_file_tmp, opts.run_timeout);
+                timing.run_s = secs_since(run_start);
+                if( !passed )
                 {
                     DEBUG("RUN FAIL " << test.m_name);
 
@@ -445,11 +456,7 @@ int main(int argc, const char* argv[])
                     rename(run_out_file_tmp.str().c_str(), fail_file.str().c_str());
                     DEBUG("- Output in " << fail_file);
 
-                    n_fail ++;
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
+                    return TestResult::RunFail;
                 }
                 else
                 {
@@ -463,9 +470,98 @@ int main(int argc, const char* argv[])
                     DEBUG("Unchanged " << test.m_name);
             }
 
-            n_ok ++;
+            return TestResult::Ok;
+        };
+
+        // Hand tests out in order to `num_jobs` workers (the calling thread is used when running serially)
+        ::std::vector<TestTiming>   timings(tests.size());
+        ::std::atomic<size_t>   next_test { 0 };
+        ::std::atomic<bool> failed_fast { false };
+        auto worker = [&]() {
+            while( !gInterrupted && !failed_fast )
+            {
+                size_t idx = next_test ++;
+                if( idx >= tests.size() )
+                    break;
+                auto& timing = timings[idx];
+                timing.result = run_test(tests[idx], timing);
+                if( opts.fail_fast && (timing.result == TestResult::CompileFail || timing.result == TestResult::RunFail) )
+                    failed_fast = true;
+            }
+            };
+        if( opts.num_jobs <= 1 )
+        {
+            worker();
+        }
+        else
+        {
+            ::std::vector<::std::thread>    workers;
+            for(unsigned i = 0; i < opts.num_jobs; i ++)
+                workers.push_back(::std::thread(worker));
+            for(auto& t : workers)
+                t.join();
+        }
+        if( gInterrupted ) {
+            DEBUG(">> Interrupted");
+            return 1;
+        }
+
+        unsigned n_skip = 0;
+        unsigned n_cfail = 0;
+        unsigned n_fail = 0;
+        unsigned n_ok = 0;
+        for(const auto& t : timings)
+        {
+            switch(t.result)
+            {
+            case TestResult::NotRun:    break;
+            case TestResult::Skip:  n_skip ++;  break;
+            case TestResult::Ok:    n_ok ++;    break;
+            case TestResult::CompileFail:   n_cfail ++; break;
+            case TestResult::RunFail:   n_fail ++;  break;
+            }
         }
 
+        // Per-test timing report (slowest first), only includes tests that were compiled or run this time
+        {
+            ::std::vector<size_t>   order;
+            for(size_t i = 0; i < tests.size(); i ++)
+            {
+                if( timings[i].compile_s > 0 || timings[i].run_s > 0 )
+                    order.push_back(i);
+            }
+            ::std::sort(order.begin(), order.end(), [&](size_t a, size_t b){
+                return timings[a].compile_s + timings[a].run_s > timings[b].compile_s + timings[b].run_s;
+                });
+            auto report_path = outdir / "test_times.txt";
+            ::std::ofstream os(report_path.str());
+            if( !os.good() )
+            {
+                ::std::cerr << "Unable to open " << report_path << " for writing" << ::std::endl;
+            }
+            else
+            {
+                os << "# total_s compile_s run_s result name" << ::std::endl;
+                os << ::std::fixed << ::std::setprecision(3);
+                for(size_t i : order)
+                {
+                    const auto& t = timings[i];
+                    const char* result_str = "";
+                    switch(t.result)
+                    {
+                    case TestResult::NotRun:    result_str = "-";   break;
+                    case TestResult::Skip:  result_str = "SKIP";    break;
+                    case TestResult::Ok:    result_str = "OK";  break;
+                    case TestResult::CompileFail:   result_str = "CFAIL";   break;
+                    case TestResult::RunFail:   result_str = "FAIL";    break;
+                    }
+                    os << t.compile_s + t.run_s << " " << t.compile_s << " " << t.run_s << " " << result_str << " " << tests[i].m_name << ::std::endl;
+                }
+            }
+        }
+        if( failed_fast )
+            return 1;
+
         ::std::cout << "TESTS COMPLETED" << ::std::endl;
         ::std::cout << n_ok << " passed, " << n_fail << " failed, " << n_cfail << " errored, " << n_skip << " skipped" << ::std::endl;
 
@@ -521,6 +617,21 @@ int Options::parse(int argc, const char* argv[])
                 }
                 this->lib_dirs.push_back( argv[++i] );
                 break;
+            case 'j':
+                // `-j<n>` or `-j <n>`, zero/missing uses all cores
+                if( arg[2] ) {
+                    this->num_jobs = static_cast<unsigned>(::std::strtoul(arg+2, nullptr, 10));
+                }
+                else if( i+1 < argc && ::std::isdigit(argv[i+1][0]) ) {
+                    this->num_jobs = static_cast<unsigned>(::std::strtoul(argv[++i], nullptr, 10));
+                }
+                else {
+                    this->num_jobs = 0;
+                }
+                if( this->num_jobs == 0 ) {
+                    this->num_jobs = ::std::max(1u, ::std::thread::hardware_concurrency());
+                }
+                break;
 
             default:
                 this->usage_short();
@@ -562,6 +673,22 @@ int Options::parse(int argc, const char* argv[])
             {
                 this->fail_fast = true;
             }
+            else if( 0 == ::std::strcmp(arg, "--timeout") )
+            {
+                if( i+1 == argc ) {
+                    this->usage_short();
+                    return 1;
+                }
+                this->run_timeout = static_cast<unsigned>(::std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if( 0 == ::std::strcmp(arg, "--compile-timeout") )
+            {
+                if( i+1 == argc ) {
+                    this->usage_short();
+                    return 1;
+                }
+                this->compile_timeout = static_cast<unsigned>(::std::strtoul(argv[++i], nullptr, 10));
+            }
             else
             {
                 this->usage_short();
@@ -632,10 +759,19 @@ bool run_executable(const ::helpers::path& exe_name, const ::std::vector<const c
     CreateProcessA(exe_name.str().c_str(), (LPSTR)cmdline_str.c_str(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
     SetErrorMode(em);
     CloseHandle(si.hStdOutput);
-    // TODO: Use timeout_seconds
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    if( WaitForSingleObject(pi.hProcess, timeout_seconds > 0 ? timeout_seconds * 1000 : INFINITE) == WAIT_TIMEOUT )
+    {
+        DEBUG(exe_name << " timed out, killing it");
+        TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+        return false;
+    }
     DWORD status = 1;
     GetExitCodeProcess(pi.hProcess, &status);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
     if (status != 0)
     {
         DEBUG("Executable exited with non-zero exit status " << status);
@@ -649,37 +785,60 @@ bool run_executable(const ::helpers::path& exe_name, const ::std::vector<const c
         });
     posix_spawn_file_actions_t  file_actions;
     posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, 0, "/dev/null", O_RDONLY, 0);
     auto outfile_str = outfile.str();
     if( outfile_str != "" )
     {
         posix_spawn_file_actions_addopen(&file_actions, 1, outfile_str.c_str(), O_CREAT|O_WRONLY|O_TRUNC, 0644);
         posix_spawn_file_actions_adddup2(&file_actions, 1, 2);
     }
+    // Put the child in its own process group, so a timeout also kills anything it spawned (e.g. the C compiler)
+    posix_spawnattr_t   attrs;
+    posix_spawnattr_init(&attrs);
+    posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attrs, 0);
 
     auto argv = args;
     argv.push_back(nullptr);
     pid_t   pid;
     extern char** environ;
-    int rv = posix_spawn(&pid, exe_name.str().c_str(), &file_actions, nullptr, const_cast<char**>(argv.data()), environ);
+    int rv = posix_spawn(&pid, exe_name.str().c_str(), &file_actions, &attrs, const_cast<char**>(argv.data()), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    posix_spawnattr_destroy(&attrs);
     if( rv != 0 )
     {
         DEBUG("Error in posix_spawn of " << exe_name << " - " << rv);
         return false;
     }
 
-    posix_spawn_file_actions_destroy(&file_actions);
-
+    // Poll for completion instead of using `alarm`, as SIGALRM is process-wide and other workers may be waiting on
+    // their own children.
+    const auto deadline = ::std::chrono::steady_clock::now() + ::std::chrono::seconds(timeout_seconds);
+    unsigned poll_ms = 1;
     int status = -1;
-    // NOTE: `alarm(0)` clears any pending alarm, so no need to check before
-    // calling
-    alarm(timeout_seconds);
-    if( waitpid(pid, &status, 0) <= 0 )
+    for(;;)
     {
-        DEBUG(exe_name << " timed out, killing it");
-        kill(pid, SIGKILL);
-        return false;
+        pid_t wait_rv = waitpid(pid, &status, WNOHANG);
+        if( wait_rv == pid )
+            break;
+        if( wait_rv < 0 && errno != EINTR )
+        {
+            DEBUG("Error in waitpid for " << exe_name << " - " << errno);
+            kill(-pid, SIGKILL);
+            return false;
+        }
+        bool timed_out = (timeout_seconds > 0 && ::std::chrono::steady_clock::now() >= deadline);
+        if( timed_out || gInterrupted )
+        {
+            DEBUG(exe_name << (timed_out ? " timed out" : " interrupted") << ", killing it");
+            kill(-pid, SIGKILL);
+            while( waitpid(pid, &status, 0) < 0 && errno == EINTR )
+                ;
+            return false;
+        }
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(poll_ms));
+        poll_ms = ::std::min(poll_ms * 2, 50u);
     }
-    alarm(0);
     if( status != 0 )
     {
         if( WIFEXITED(status) )
@@ -725,9 +884,12 @@ Timestamp Timestamp::for_file(const ::helpers::path& path)
 }
 
 
+// Workers print concurrently, keep each message intact
+static ::std::mutex gDebugLock;
 static int giIndentLevel = 0;
 void Debug_Print(::std::function<void(::std::ostream& os)> cb)
 {
+    ::std::lock_guard<::std::mutex> lh { gDebugLock };
     for(auto i = giIndentLevel; i --; )
         ::std::cout << " ";
     cb(::std::cout);
@@ -735,6 +897,7 @@ void Debug_Print(::std::function<void(::std::ostream& os)> cb)
 }
 void Debug_EnterScope(const char* name, dbg_cb_t cb)
 {
+    ::std::lock_guard<::std::mutex> lh { gDebugLock };
     for(auto i = giIndentLevel; i --; )
         ::std::cout << " ";
     ::std::cout << ">>> " << name << "(";
@@ -744,6 +907,7 @@ void Debug_EnterScope(const char* name, dbg_cb_t cb)
 }
 void Debug_LeaveScope(const char* name, dbg_cb_t cb)
 {
+    ::std::lock_guard<::std::mutex> lh { gDebugLock };
     giIndentLevel --;
     for(auto i = giIndentLevel; i --; )
         ::std::cout << " ";